@@ -0,0 +1,67 @@
+#include "arena.h"
+
+#include <stdlib.h>
+
+/*
+ * arena_grow:
+ *   Push a new block of at least `cap` bytes onto the block list.
+ *   Returns 0 on success, -1 on allocation failure.
+ */
+static int arena_grow(Arena *a, size_t cap) {
+    ArenaBlock *blk = malloc(sizeof(ArenaBlock) + cap);
+    if (!blk) return -1;
+    blk->next = a->head;
+    blk->used = 0;
+    blk->cap  = cap;
+    a->head   = blk;
+    a->total += cap;
+    return 0;
+}
+
+/*
+ * arena_create:
+ *   Allocate the arena header and its first block.
+ */
+Arena *arena_create(size_t initial) {
+    Arena *a = calloc(1, sizeof(Arena));
+    if (!a) return NULL;
+    if (arena_grow(a, initial ? initial : 4096) != 0) {
+        free(a);
+        return NULL;
+    }
+    return a;
+}
+
+/*
+ * arena_alloc:
+ *   Bump-allocate from the current block; when it is full, add a block
+ *   twice as large as the last one (or exactly n bytes if that is larger).
+ */
+void *arena_alloc(Arena *a, size_t n) {
+    ArenaBlock *blk = a->head;
+    if (blk->cap - blk->used < n) {
+        size_t cap = blk->cap * 2;
+        if (cap < n) cap = n;
+        if (arena_grow(a, cap) != 0)
+            return NULL;
+        blk = a->head;
+    }
+    void *p = blk->data + blk->used;
+    blk->used += n;
+    return p;
+}
+
+/*
+ * arena_free:
+ *   Walk the block list and free each block, then the arena.
+ */
+void arena_free(Arena *a) {
+    if (!a) return;
+    ArenaBlock *blk = a->head;
+    while (blk) {
+        ArenaBlock *next = blk->next;
+        free(blk);
+        blk = next;
+    }
+    free(a);
+}
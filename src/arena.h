@@ -0,0 +1,55 @@
+#ifndef ARENA_H
+#define ARENA_H
+
+#include <stddef.h>
+
+/*
+ * ArenaBlock:
+ *   One contiguous chunk of arena memory; blocks form a singly linked list.
+ *   - next: previously filled block (or NULL).
+ *   - used: bytes handed out from data[].
+ *   - cap:  size of data[] in bytes.
+ */
+typedef struct ArenaBlock {
+    struct ArenaBlock *next;
+    size_t used;
+    size_t cap;
+    unsigned char data[];
+} ArenaBlock;
+
+/*
+ * Arena:
+ *   Bump allocator for many small objects that share one lifetime.
+ *   Allocation is a pointer bump; when a block runs out, a new block twice
+ *   the size of the last one is added, so n bytes cost O(log n) mallocs.
+ *   Individual allocations are never freed; arena_free releases everything.
+ *   - head:  current (most recently added) block.
+ *   - total: bytes reserved across all blocks.
+ */
+typedef struct {
+    ArenaBlock *head;
+    size_t total;
+} Arena;
+
+/*
+ * arena_create:
+ *   Create an arena whose first block holds at least `initial` bytes.
+ *   Returns NULL on allocation failure.
+ */
+Arena *arena_create(size_t initial);
+
+/*
+ * arena_alloc:
+ *   Return n bytes of uninitialized, byte-aligned memory (no alignment
+ *   guarantee beyond 1), or NULL on allocation failure.
+ */
+void *arena_alloc(Arena *a, size_t n);
+
+/*
+ * arena_free:
+ *   Release all blocks and the arena itself.
+ *   Safe to call with a NULL pointer.
+ */
+void arena_free(Arena *a);
+
+#endif /* ARENA_H */
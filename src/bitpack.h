@@ -0,0 +1,119 @@
+#ifndef BITPACK_H
+#define BITPACK_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * Small encoding helpers shared by the on-disk trace and in-memory results.
+ *   - Faces (1..sides) are stored as face-1 in a fixed number of bits,
+ *     LSB-first, so a d6 costs 3 bits per roll instead of a size_t.
+ *   - Lengths are stored as LEB128 varints (7 bits per byte).
+ */
+
+/*
+ * bits_for_sides:
+ *   Number of bits needed to store face-1 for a die with `sides` faces
+ *   (at least 1).
+ */
+static inline unsigned bits_for_sides(size_t sides) {
+    unsigned bits = 1;
+    while (bits < 64 && (sides - 1) >> bits)
+        bits++;
+    return bits;
+}
+
+/*
+ * packed_bytes:
+ *   Bytes occupied by n faces of `bits` bits each.
+ */
+static inline size_t packed_bytes(size_t n, unsigned bits) {
+    return (n * bits + 7) / 8;
+}
+
+/*
+ * pack_faces:
+ *   Write seq[0..n-1] (values 1..2^bits) into dst as packed face-1 values.
+ *   dst must have room for packed_bytes(n, bits) bytes.
+ *   Returns the number of bytes written.
+ */
+static inline size_t pack_faces(uint8_t *dst, const size_t *seq,
+                                size_t n, unsigned bits)
+{
+    uint64_t acc = 0;
+    unsigned fill = 0;
+    uint8_t *p = dst;
+    for (size_t i = 0; i < n; ++i) {
+        acc |= (uint64_t)(seq[i] - 1) << fill;
+        fill += bits;
+        while (fill >= 8) {
+            *p++ = (uint8_t)acc;
+            acc >>= 8;
+            fill -= 8;
+        }
+    }
+    if (fill)
+        *p++ = (uint8_t)acc;
+    return (size_t)(p - dst);
+}
+
+/*
+ * unpack_faces:
+ *   Inverse of pack_faces: decode n faces from src into seq (values 1..).
+ *   Returns the number of bytes consumed.
+ */
+static inline size_t unpack_faces(size_t *seq, const uint8_t *src,
+                                  size_t n, unsigned bits)
+{
+    uint64_t acc = 0;
+    unsigned fill = 0;
+    uint64_t mask = (bits >= 64) ? ~0ULL : ((1ULL << bits) - 1);
+    const uint8_t *p = src;
+    for (size_t i = 0; i < n; ++i) {
+        while (fill < bits) {
+            acc |= (uint64_t)*p++ << fill;
+            fill += 8;
+        }
+        seq[i] = (size_t)(acc & mask) + 1;
+        acc >>= bits;
+        fill -= bits;
+    }
+    return (size_t)(p - src);
+}
+
+/*
+ * varint_put:
+ *   Encode v as an unsigned LEB128 varint (at most 10 bytes).
+ *   Returns the number of bytes written.
+ */
+static inline size_t varint_put(uint8_t *dst, uint64_t v) {
+    size_t n = 0;
+    while (v >= 0x80) {
+        dst[n++] = (uint8_t)(v | 0x80);
+        v >>= 7;
+    }
+    dst[n++] = (uint8_t)v;
+    return n;
+}
+
+/*
+ * varint_get:
+ *   Decode a varint from [src, end).
+ *   Returns the number of bytes consumed, or 0 if the input is truncated
+ *   or longer than 10 bytes.
+ */
+static inline size_t varint_get(const uint8_t *src, const uint8_t *end,
+                                uint64_t *v)
+{
+    uint64_t out = 0;
+    for (size_t n = 0; n < 10 && src + n < end; ++n) {
+        out |= (uint64_t)(src[n] & 0x7f) << (7 * n);
+        if (!(src[n] & 0x80)) {
+            *v = out;
+            return n + 1;
+        }
+    }
+    return 0;
+}
+
+#endif /* BITPACK_H */
@@ -6,9 +6,9 @@
 #include <string.h>   
 
 /*
- * board_load:
- *   Load a game board from a file.
- *   The file format is:
+ * board_read:
+ *   Parse a game board from an open stream.
+ *   The format is:
  *     N M           (board dimensions: N rows, M columns)
  *     t s e         (zero or more jumps, where t is ignored, s=start index, e=end index)
  *   Returns a pointer to a newly allocated Board, or NULL on any error.
@@ -21,21 +21,14 @@
  *   - Accepts 1-based s/e in the file and converts to 0-based internally.
  *   - Skips blank lines and lines beginning with '#'.
  */
-Board *board_load(const char *filename) {
-    FILE *f = fopen(filename, "r");
-    if (!f) return NULL;
-
+Board *board_read(FILE *f, const char *filename) {
     size_t N, M;
-    if (fscanf(f, "%zu %zu\n", &N, &M) != 2) {
-        fclose(f);
+    if (fscanf(f, "%zu %zu\n", &N, &M) != 2)
         return NULL;
-    }
 
     Board *b = calloc(1, sizeof(Board));
-    if (!b) {
-        fclose(f);
+    if (!b)
         return NULL;
-    }
     b->N    = N;
     b->M    = M;
     b->size = N * M;
@@ -72,7 +65,6 @@ Board *board_load(const char *filename) {
                 tmp = realloc(tmp, cap * sizeof(Jump));
                 if (!tmp) {
                     fprintf(stderr, "Error: out of memory loading jumps\n");
-                    fclose(f);
                     free(b);
                     return NULL;
                 }
@@ -81,7 +73,6 @@ Board *board_load(const char *filename) {
         }
         /* else malformed line — skip */
     }
-    fclose(f);
 
     b->n_jumps = cnt;
     b->jumps   = tmp;
@@ -110,6 +101,83 @@ Board *board_load(const char *filename) {
     return b;
 }
 
+/*
+ * board_load:
+ *   Open the file and hand it to board_read.
+ */
+Board *board_load(const char *filename) {
+    FILE *f = fopen(filename, "r");
+    if (!f) return NULL;
+    Board *b = board_read(f, filename);
+    fclose(f);
+    return b;
+}
+
+/*
+ * mark_dead_squares:
+ *   Reverse breadth-first search from the last square over the edges of
+ *   b->adj that belong to rollable faces (weight > 0, or all faces when
+ *   face_weights is NULL). Every square not reached is dead.
+ *   - The reverse graph is built in compressed form (offsets + sources)
+ *     so the search is O(size * die_sides).
+ *   Returns 0 on success, -1 on allocation failure.
+ */
+static int mark_dead_squares(Board *b, size_t die_sides,
+                             const double *face_weights)
+{
+    size_t n = b->size;
+    size_t *start = calloc(n + 1, sizeof(size_t));
+    size_t *src   = malloc(n * die_sides * sizeof(size_t));
+    size_t *queue = malloc(n * sizeof(size_t));
+    b->dead = malloc(n);
+    if (!start || !src || !queue || !b->dead) {
+        free(start);
+        free(src);
+        free(queue);
+        return -1;
+    }
+
+    /* count incoming edges per square, then prefix-sum into offsets */
+    for (size_t i = 0; i < n; ++i)
+        for (size_t f = 0; f < die_sides; ++f)
+            if (!face_weights || face_weights[f] > 0.0)
+                start[b->adj[i][f] + 1]++;
+    for (size_t i = 0; i < n; ++i)
+        start[i + 1] += start[i];
+
+    /* scatter sources; queue doubles as the per-square fill cursor here */
+    memcpy(queue, start, n * sizeof(size_t));
+    for (size_t i = 0; i < n; ++i)
+        for (size_t f = 0; f < die_sides; ++f)
+            if (!face_weights || face_weights[f] > 0.0)
+                src[queue[b->adj[i][f]]++] = i;
+
+    /* BFS backwards from the goal; dead == 1 means "not reached yet" */
+    memset(b->dead, 1, n);
+    size_t head = 0, tail = 0;
+    b->dead[n - 1] = 0;
+    queue[tail++]  = n - 1;
+    while (head < tail) {
+        size_t v = queue[head++];
+        for (size_t e = start[v]; e < start[v + 1]; ++e) {
+            if (b->dead[src[e]]) {
+                b->dead[src[e]] = 0;
+                queue[tail++]   = src[e];
+            }
+        }
+    }
+
+    b->n_dead = 0;
+    for (size_t i = 0; i < n; ++i)
+        if (b->dead[i] && (b->mapping[i] == i || i == 0))
+            b->n_dead++;
+
+    free(start);
+    free(src);
+    free(queue);
+    return 0;
+}
+
 /*
  * board_build_graph:
  *   Build the game graph for a loaded Board.
@@ -119,17 +187,25 @@ Board *board_load(const char *filename) {
  *       * otherwise, stay on i (no move)
  *   - After computing the raw destination, apply any snake/ladder jump via b->mapping.
  *   Allocates b->adj[i] arrays of length die_sides and fills them with final destinations.
+ *   Finally runs mark_dead_squares so simulations can stop as soon as a
+ *   game enters a square it can never win from.
  */
-void board_build_graph(Board *b,
-                       size_t die_sides,
-                       int win_by_exceed)
+int board_build_graph(Board *b,
+                      size_t die_sides,
+                      const double *face_weights,
+                      int win_by_exceed)
 {
+    b->win_by_exceed = win_by_exceed;
+
     /* every node has exactly die_sides neighbors */
     for (size_t i = 0; i < b->size; ++i)
         b->adj_cnt[i] = die_sides;
 
-    for (size_t i = 0; i < b->size; ++i)
+    for (size_t i = 0; i < b->size; ++i) {
         b->adj[i] = malloc(die_sides * sizeof(size_t));
+        if (!b->adj[i])
+            return -1;
+    }
 
     for (size_t i = 0; i < b->size; ++i) {
         for (size_t f = 1; f <= die_sides; ++f) {
@@ -147,6 +223,8 @@ void board_build_graph(Board *b,
             b->adj[i][f-1] = dest;
         }
     }
+
+    return mark_dead_squares(b, die_sides, face_weights);
 }
 
 /*
@@ -154,7 +232,8 @@ void board_build_graph(Board *b,
  *   Free all memory associated with a Board.
  *   Safely handles a NULL pointer.
  *   - Frees the jumps array and mapping array.
- *   - Frees each adjacency list, then the adj and adj_cnt arrays.
+ *   - Frees each adjacency list, then the adj and adj_cnt arrays
+ *     and the dead-square flags.
  *   - Finally frees the Board struct itself.
  */
 void board_free(Board *b) {
@@ -167,5 +246,6 @@ void board_free(Board *b) {
         free(b->adj);
     }
     free(b->adj_cnt);
+    free(b->dead);
     free(b);
 }
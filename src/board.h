@@ -2,6 +2,7 @@
 #define BOARD_H
 
 #include <stddef.h>
+#include <stdio.h>
 
 /*
  * Jump:
@@ -24,6 +25,11 @@ typedef struct {
  *   - mapping:  for each square i, the destination after applying any jump.
  *   - adj:      adjacency lists: adj[i] is an array of neighbor square indices.
  *   - adj_cnt:  for each square i, the number of neighbors in adj[i].
+ *   - dead:     dead[i] != 0 if the last square cannot be reached from i with
+ *               the faces that can actually be rolled (set by board_build_graph).
+ *   - win_by_exceed: rule the graph was built with (see board_build_graph).
+ *   - n_dead:   number of dead squares a token can stand on (jump starts
+ *               other than the start are never occupied and are not counted).
  */
 typedef struct {
     size_t N, M;        /* dimensions */
@@ -35,6 +41,11 @@ typedef struct {
     /* Graph representation: adjacency lists for die rolls */
     size_t **adj;       /* adj[i] = array of neighbor square indices */
     size_t  *adj_cnt;   /* adj_cnt[i] = number of neighbors in adj[i] */
+    int      win_by_exceed; /* rule used by board_build_graph */
+
+    /* Squares from which the goal is unreachable */
+    unsigned char *dead; /* dead[i] != 0: game can never be won from i */
+    size_t  n_dead;      /* occupiable dead squares */
 } Board;
 
 /*
@@ -51,17 +62,31 @@ typedef struct {
  */
 Board *board_load(const char *filename);
 
+/*
+ * board_read:
+ *   Same as board_load, but parse the configuration from an already open
+ *   stream (e.g. a board received over a socket via fmemopen).
+ *   - filename: name used in warnings only.
+ *   The stream is not closed.
+ */
+Board *board_read(FILE *f, const char *filename);
+
 /*
  * board_build_graph:
  *   Construct the adjacency lists for a loaded Board given die properties.
  *   - die_sides:    number of faces on the die (D).
+ *   - face_weights: optional array of length D; faces with weight 0 can
+ *                   never be rolled. NULL means every face is possible.
  *   - win_by_exceed:
  *       * non-zero: moves past the last square clamp to the last square.
  *       * zero:      must land exactly on the last square to win.
  *   This fills Board->adj and Board->adj_cnt so that for every square i,
- *   adj[i][k] gives the destination square for a roll of (k+1).
+ *   adj[i][k] gives the destination square for a roll of (k+1), then marks
+ *   Board->dead with every square from which the last square is unreachable.
+ *   Returns 0 on success, -1 on allocation failure.
  */
-void board_build_graph(Board *b, size_t die_sides, int win_by_exceed);
+int board_build_graph(Board *b, size_t die_sides,
+                      const double *face_weights, int win_by_exceed);
 
 /*
  * board_free:
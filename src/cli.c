@@ -28,11 +28,54 @@ static char *iso_strdup(const char *s) {
  *     -c <file>       Path to the board configuration file (required).
  *     -d <sides>      Number of die sides (default: 6).
  *     -p <p1,p2,…>    Comma-separated probabilities for each die face (must match die_sides).
+ *     -D <expr>       Move by the sum of a dice expression such as 2d6, 3d4 or
+ *                     2d6+1d4 (see die_dice_weights); the sum distribution is
+ *                     computed once and used as a single weighted die with one
+ *                     face per possible sum. Not with -d or -p.
  *     -i <iters>      Number of simulations to run (default: 10000).
  *     -s <steps>      Maximum steps allowed per game (default: 10000).
  *     -e              Enable “win by exceeding” the last square (default: on).
  *     -x              Require exact roll to land on the last square (disables win-by-exceed).
  *     -S <seed>       Seed for the random number generator (default: time(NULL)).
+ *     -j <threads>    Play the games on this many threads (default: 1); not
+ *                     with --shard, --checkpoint or --resume.
+ *     --shard <k/n>   Simulate only shard k (0-based) of n equal game ranges.
+ *     --checkpoint <file>
+ *                     Periodically save RNG position and accumulators to file;
+ *                     the final save is the shard's result for --merge.
+ *     --checkpoint-every <n>
+ *                     Games between checkpoints (default: 100000, 0 = end only).
+ *     --resume <file> Continue an interrupted run from its checkpoint.
+ *     --merge <f1> [f2 …]
+ *                     Merge finished shard checkpoints and print the combined
+ *                     statistics; consumes all remaining arguments.
+ *     --trace <file>  Stream every game's roll sequence to a packed trace file.
+ *     --trace-stats <file>
+ *                     Recompute statistics from a trace (needs -c and -d of the
+ *                     recorded run) instead of simulating.
+ *     --trace-replay <file> <game>
+ *                     Print game <game> of a trace roll by roll.
+ *     --kernel <name> Force a simulation kernel: auto (default), generic,
+ *                     skip, multi or fair.
+ *     --heatmap <file>
+ *                     Write simulated and exact landings per square as N×M
+ *                     grids to file.
+ *     --exact         Solve the Markov chain for the expected rolls of a won
+ *                     game and the win probability instead of simulating.
+ *     --gradient      Print the exact expected rolls with their gradient with
+ *                     respect to every face probability and jump.
+ *     --daemon <socket>
+ *                     Serve queries on a Unix domain socket with -j worker
+ *                     threads; no board is needed (-c is optional).
+ *     --query <socket>
+ *                     Send the board, die, rules, kernel, -i/-s/-S and
+ *                     --exact/--gradient to a daemon and print its reply.
+ *     --progress <seconds>
+ *                     Print a progress line to stderr every <seconds> while
+ *                     the games are played.
+ *     --keep <k>      Retain and print the k shortest and the k longest
+ *                     winning games with their rolls.
+ *     --sample <m>    Retain and print a uniform random sample of m games.
  *
  *   Behavior:
  *     - Sets all fields of opts to their defaults.
@@ -48,6 +91,30 @@ void parse_cli(int argc, char **argv, CLIOptions *opts) {
     opts->max_steps     = 10000;
     opts->win_by_exceed = 1;
     opts->seed          = (unsigned)time(NULL);
+    opts->shard_index   = 0;
+    opts->shard_count   = 1;
+    opts->checkpoint_file  = NULL;
+    opts->checkpoint_every = 100000;
+    opts->resume_file   = NULL;
+    opts->merge_files   = NULL;
+    opts->n_merge       = 0;
+    opts->trace_file        = NULL;
+    opts->trace_stats_file  = NULL;
+    opts->trace_replay_file = NULL;
+    opts->trace_replay_game = 0;
+    opts->kernel            = SIM_KERNEL_AUTO;
+    opts->threads           = 1;
+    opts->heatmap_file      = NULL;
+    opts->exact             = 0;
+    opts->gradient          = 0;
+    opts->daemon_socket     = NULL;
+    opts->query_socket      = NULL;
+    opts->progress_secs     = 0.0;
+    opts->keep_games        = 0;
+    opts->sample_games      = 0;
+
+    /* -d/-p and -D both define the die; remember which were given */
+    int have_sides = 0, have_dice = 0;
 
     /* Parse each argument */
     for (int i = 1; i < argc; ++i) {
@@ -56,11 +123,25 @@ void parse_cli(int argc, char **argv, CLIOptions *opts) {
         }
         else if (strcmp(argv[i], "-d") == 0 && i+1 < argc) {
             opts->die_sides = (size_t)atoi(argv[++i]);
+            have_sides = 1;
+        }
+        else if (strcmp(argv[i], "-D") == 0 && i+1 < argc) {
+            free(opts->die_probs);
+            opts->die_probs = die_dice_weights(argv[++i], &opts->die_sides);
+            if (!opts->die_probs) {
+                fprintf(stderr,
+                        "Error: invalid dice expression '%s' (expected "
+                        "terms like 2d6 or 3 joined by '+', largest sum "
+                        "at most %d)\n", argv[i], DIE_MAX_SIDES);
+                exit(1);
+            }
+            have_dice = 1;
         }
         else if (strcmp(argv[i], "-p") == 0 && i+1 < argc) {
             /* Parse comma-separated die probabilities */
             char *list = iso_strdup(argv[++i]);
             size_t n = opts->die_sides;
+            have_sides = 1;
             opts->die_probs = malloc(n * sizeof(double));
             if (!opts->die_probs) {
                 fprintf(stderr, "Error: out of memory\n");
@@ -95,17 +176,107 @@ void parse_cli(int argc, char **argv, CLIOptions *opts) {
         else if (strcmp(argv[i], "-S") == 0 && i+1 < argc) {
             opts->seed = (unsigned)atoi(argv[++i]);
         }
+        else if (strcmp(argv[i], "-j") == 0 && i+1 < argc) {
+            opts->threads = (size_t)atoi(argv[++i]);
+            if (opts->threads == 0) {
+                fprintf(stderr, "Error: -j expects at least 1 thread\n");
+                exit(1);
+            }
+        }
+        else if (strcmp(argv[i], "--shard") == 0 && i+1 < argc) {
+            if (sscanf(argv[++i], "%zu/%zu",
+                       &opts->shard_index, &opts->shard_count) != 2 ||
+                opts->shard_count == 0 ||
+                opts->shard_index >= opts->shard_count) {
+                fprintf(stderr,
+                        "Error: --shard expects k/n with 0 <= k < n\n");
+                exit(1);
+            }
+        }
+        else if (strcmp(argv[i], "--checkpoint") == 0 && i+1 < argc) {
+            opts->checkpoint_file = iso_strdup(argv[++i]);
+        }
+        else if (strcmp(argv[i], "--checkpoint-every") == 0 && i+1 < argc) {
+            opts->checkpoint_every = (size_t)atoi(argv[++i]);
+        }
+        else if (strcmp(argv[i], "--resume") == 0 && i+1 < argc) {
+            opts->resume_file = iso_strdup(argv[++i]);
+        }
+        else if (strcmp(argv[i], "--trace") == 0 && i+1 < argc) {
+            opts->trace_file = iso_strdup(argv[++i]);
+        }
+        else if (strcmp(argv[i], "--trace-stats") == 0 && i+1 < argc) {
+            opts->trace_stats_file = iso_strdup(argv[++i]);
+        }
+        else if (strcmp(argv[i], "--trace-replay") == 0 && i+2 < argc) {
+            opts->trace_replay_file = iso_strdup(argv[++i]);
+            opts->trace_replay_game = (size_t)strtoull(argv[++i], NULL, 10);
+        }
+        else if (strcmp(argv[i], "--kernel") == 0 && i+1 < argc) {
+            if (sim_kernel_parse(argv[++i], &opts->kernel) != 0) {
+                fprintf(stderr,
+                        "Error: --kernel expects auto, generic, skip, multi "
+                        "or fair\n");
+                exit(1);
+            }
+        }
+        else if (strcmp(argv[i], "--heatmap") == 0 && i+1 < argc) {
+            opts->heatmap_file = iso_strdup(argv[++i]);
+        }
+        else if (strcmp(argv[i], "--exact") == 0) {
+            opts->exact = 1;
+        }
+        else if (strcmp(argv[i], "--gradient") == 0) {
+            opts->gradient = 1;
+        }
+        else if (strcmp(argv[i], "--daemon") == 0 && i+1 < argc) {
+            opts->daemon_socket = iso_strdup(argv[++i]);
+        }
+        else if (strcmp(argv[i], "--query") == 0 && i+1 < argc) {
+            opts->query_socket = iso_strdup(argv[++i]);
+        }
+        else if (strcmp(argv[i], "--progress") == 0 && i+1 < argc) {
+            opts->progress_secs = atof(argv[++i]);
+        }
+        else if (strcmp(argv[i], "--keep") == 0 && i+1 < argc) {
+            opts->keep_games = (size_t)strtoull(argv[++i], NULL, 10);
+        }
+        else if (strcmp(argv[i], "--sample") == 0 && i+1 < argc) {
+            opts->sample_games = (size_t)strtoull(argv[++i], NULL, 10);
+        }
+        else if (strcmp(argv[i], "--merge") == 0 && i+1 < argc) {
+            /* remaining arguments are shard files (point into argv) */
+            opts->merge_files = &argv[i+1];
+            opts->n_merge     = (size_t)(argc - i - 1);
+            break;
+        }
         else {
             fprintf(stderr,
                 "Usage: %s -c board.txt [-d sides] [-p p1,p2,...] "
-                "[-i iters] [-s steps] [-e|-x] [-S seed]\n",
+                "[-D dice]\n"
+                "       [-i iters] [-s steps] [-e|-x] [-S seed] "
+                "[-j threads]\n"
+                "       [--shard k/n] [--checkpoint file] "
+                "[--checkpoint-every n] [--resume file]\n"
+                "       [--trace file] [--trace-stats file] "
+                "[--trace-replay file game]\n"
+                "       [--kernel auto|generic|skip|multi|fair] "
+                "[--heatmap file] [--exact] [--gradient]\n"
+                "       [--daemon socket] [--query socket] "
+                "[--progress seconds] [--keep k] [--sample m]\n"
+                "       [--merge shard1 shard2 ...]\n",
                 argv[0]);
             exit(1);
         }
     }
 
+    if (have_dice && have_sides) {
+        fprintf(stderr, "Error: -D cannot be combined with -d or -p\n");
+        exit(1);
+    }
+
     /* Ensure required config file was provided */
-    if (!opts->config_file) {
+    if (!opts->config_file && !opts->daemon_socket) {
         fprintf(stderr, "Error: board config file required (-c)\n");
         exit(1);
     }
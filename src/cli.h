@@ -3,6 +3,8 @@
 
 #include <stddef.h>
 
+#include "sim.h"
+
 /*
  * CLIOptions:
  *   Holds configuration options parsed from the command line.
@@ -11,11 +13,36 @@
  *   - die_sides:     Number of faces on the die (default: 6).
  *   - die_probs:     Optional array of probabilities for each die face
  *                    (length = die_sides). If NULL, the die is fair.
+ *                    A dice expression (-D) sets both die_sides and
+ *                    die_probs to the distribution of its sum.
  *   - iterations:    Number of game simulations to run (default: 10000).
  *   - max_steps:     Maximum rolls per game before aborting (default: 10000).
  *   - win_by_exceed: Non-zero to allow winning by exceeding the last square;
  *                    zero to require an exact roll (default: on).
  *   - seed:          Seed for the random number generator (default: time(NULL)).
+ *   - shard_index, shard_count:
+ *                    Run only shard k of n of the game range (default: 0/1).
+ *   - checkpoint_file: Where to save shard checkpoints (default: none).
+ *   - checkpoint_every: Games between checkpoints (default: 100000).
+ *   - resume_file:   Checkpoint to continue from (default: none).
+ *   - merge_files, n_merge:
+ *                    Finished shard files to merge instead of simulating.
+ *   - trace_file:    Stream every game's rolls to this trace (default: none).
+ *   - trace_stats_file: Recompute statistics from this trace instead of
+ *                    simulating.
+ *   - trace_replay_file, trace_replay_game:
+ *                    Print one game of this trace roll by roll.
+ *   - kernel:        Simulation kernel (default: SIM_KERNEL_AUTO).
+ *   - threads:       Worker threads for in-memory runs (default: 1).
+ *   - heatmap_file:  Write the per-square occupancy grid here (default: none).
+ *   - exact:         Print exact Markov-chain results instead of simulating.
+ *   - gradient:      Print the exact expected rolls and their sensitivities
+ *                    to the die and the jumps instead of simulating.
+ *   - daemon_socket: Serve queries on this Unix socket (default: none).
+ *   - query_socket:  Send the run as a query to the daemon on this socket.
+ *   - progress_secs: Seconds between progress lines on stderr (0 = none).
+ *   - keep_games:    Keep the k shortest and k longest wins (default: 0).
+ *   - sample_games:  Keep a uniform sample of m games (default: 0).
  */
 typedef struct {
     size_t N, M;
@@ -26,6 +53,26 @@ typedef struct {
     size_t  max_steps;
     int     win_by_exceed;
     unsigned seed;
+    size_t  shard_index, shard_count;
+    char   *checkpoint_file;
+    size_t  checkpoint_every;
+    char   *resume_file;
+    char  **merge_files;
+    size_t  n_merge;
+    char   *trace_file;
+    char   *trace_stats_file;
+    char   *trace_replay_file;
+    size_t  trace_replay_game;
+    SimKernel kernel;
+    size_t  threads;
+    char   *heatmap_file;
+    int     exact;
+    int     gradient;
+    char   *daemon_socket;
+    char   *query_socket;
+    double  progress_secs;
+    size_t  keep_games;
+    size_t  sample_games;
 } CLIOptions;
 
 /*
@@ -35,11 +82,30 @@ typedef struct {
  *     -c <file>       (required) board configuration file path
  *     -d <sides>      die sides
  *     -p <p1,p2,…>    comma-separated die face probabilities
+ *     -D <expr>       move by the sum of several dice, e.g. 2d6 or 2d6+1d4
  *     -i <iters>      number of simulations
  *     -s <steps>      max rolls per game
  *     -e              enable win-by-exceed
  *     -x              require exact roll to win
  *     -S <seed>       RNG seed
+ *     -j <threads>    worker threads
+ *     --shard <k/n>   run shard k (0-based) of n
+ *     --checkpoint <file>      save progress/results of the run to file
+ *     --checkpoint-every <n>   games between checkpoints
+ *     --resume <file>          continue a run from a checkpoint
+ *     --merge <f1> [f2 …]      merge finished shards (must be last)
+ *     --trace <file>           record every game to a packed trace
+ *     --trace-stats <file>     recompute statistics from a trace
+ *     --trace-replay <file> <game>  print one game from a trace
+ *     --kernel <name>          auto|generic|skip|multi|fair
+ *     --heatmap <file>         write the occupancy heatmap to file
+ *     --exact                  print exact results instead of simulating
+ *     --gradient               print exact sensitivities of the game length
+ *     --daemon <socket>        serve queries (-c not needed)
+ *     --query <socket>         ask a running daemon instead of computing
+ *     --progress <seconds>     print progress snapshots while simulating
+ *     --keep <k>               print the k shortest and k longest wins
+ *     --sample <m>             print a uniform sample of m games
  *   On invalid or missing required options, prints an error or usage message
  *   and exits the program.
  */
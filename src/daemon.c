@@ -0,0 +1,896 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include "daemon.h"
+#include "board.h"
+#include "die.h"
+#include "hash.h"
+#include "markov.h"
+#include "parallel.h"
+#include "sim.h"
+#include "stats.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <inttypes.h>
+#include <limits.h>
+#include <poll.h>
+#include <pthread.h>
+#include <signal.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <time.h>
+#include <unistd.h>
+
+#define QUERY_MAGIC   "pfusch-query"
+#define QUERY_VERSION 2
+
+/*
+ * Query:
+ *   A parsed request. `weights` and `board` point into the request buffer
+ *   or a private copy, never into shared cache entries.
+ */
+typedef struct {
+    int         exact;
+    int         gradient;
+    size_t      sides;
+    int         win_by_exceed;
+    SimKernel   kernel;
+    size_t      n_weights;
+    double     *weights;
+    size_t      iterations;
+    size_t      max_steps;
+    uint64_t    seed;
+    RetainSpec  keep;
+    const char *board;
+    size_t      board_len;
+} Query;
+
+/*
+ * Graph:
+ *   A cached built board with everything needed to simulate on it.
+ *   - key:        hash of board text, die, weights, rule and kernel.
+ *   - text, weights, ...: copies of the key's inputs (to rule out hash
+ *                 collisions).
+ *   - refs:       queries currently using the entry; only unused entries
+ *                 are evicted.
+ *   - cached:     0 once the entry was dropped from (or never entered) the
+ *                 cache; the last user then frees it.
+ *   - last_used:  daemon clock value of the latest lookup, for LRU.
+ */
+typedef struct {
+    uint64_t  key;
+    char     *text;
+    size_t    text_len;
+    size_t    sides;
+    size_t    n_weights;
+    double   *weights;
+    int       win_by_exceed;
+    SimKernel kernel;
+    Board    *b;
+    Die      *d;
+    SimPlan  *plan;
+    size_t    refs;
+    int       cached;
+    uint64_t  last_used;
+} Graph;
+
+/*
+ * Result:
+ *   A memoized reply, keyed by the complete request bytes.
+ */
+typedef struct {
+    uint64_t key;
+    char    *request;
+    size_t   request_len;
+    char    *reply;
+    size_t   reply_len;
+} Result;
+
+/*
+ * Daemon:
+ *   State shared by the accept loop and the workers; everything below
+ *   `lock` is protected by it.
+ *   - queue:   ring of accepted connections (head, count).
+ *   - results: ring of memoized replies, next_result is the slot to reuse.
+ */
+typedef struct {
+    pthread_mutex_t lock;
+    pthread_cond_t  not_empty, not_full;
+    int             queue[DAEMON_QUEUE];
+    size_t          head, count;
+    int             stopping;
+    Graph          *graphs[DAEMON_MAX_GRAPHS];
+    size_t          n_graphs;
+    Result          results[DAEMON_MAX_RESULTS];
+    size_t          n_results, next_result;
+    uint64_t        clock;
+} Daemon;
+
+static volatile sig_atomic_t stop_requested;
+
+/*
+ * on_stop:
+ *   SIGINT/SIGTERM handler: ask the accept loop to finish.
+ */
+static void on_stop(int sig) {
+    (void)sig;
+    stop_requested = 1;
+}
+
+/*
+ * deadline_in:
+ *   The CLOCK_MONOTONIC time `seconds` from now.
+ */
+static struct timespec deadline_in(int seconds) {
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    t.tv_sec += seconds;
+    return t;
+}
+
+/*
+ * wait_ready:
+ *   Wait until fd is ready for `events` (POLLIN / POLLOUT) or the deadline
+ *   passes; without a deadline return at once and let the call block.
+ *   Returns 0 when ready, -1 with errno set to EAGAIN once the deadline
+ *   has passed or to poll's error.
+ */
+static int wait_ready(int fd, short events, const struct timespec *deadline) {
+    while (deadline) {
+        struct timespec now;
+        clock_gettime(CLOCK_MONOTONIC, &now);
+        long long ms = (long long)(deadline->tv_sec - now.tv_sec) * 1000 +
+                       (deadline->tv_nsec - now.tv_nsec) / 1000000;
+        if (ms <= 0) {
+            errno = EAGAIN;
+            return -1;
+        }
+        struct pollfd pfd = { .fd = fd, .events = events };
+        int r = poll(&pfd, 1, ms < INT_MAX ? (int)ms : INT_MAX);
+        if (r > 0)
+            break;
+        if (r < 0 && errno != EINTR)
+            return -1;
+    }
+    return 0;
+}
+
+/*
+ * read_all / write_all:
+ *   Move a whole buffer over a socket, retrying short transfers and EINTR.
+ *   With a deadline (daemon side, on a non-blocking socket) the whole
+ *   transfer must finish before it, however the peer paces its data;
+ *   NULL means no limit.
+ *   read_all reads until EOF into a growing buffer of at most `limit`
+ *   bytes and returns it (NUL-terminated) with its length in *len. On
+ *   failure it returns NULL with errno set: EAGAIN when the deadline
+ *   passed, EMSGSIZE when the limit was reached.
+ */
+static char *read_all(int fd, size_t limit, const struct timespec *deadline,
+                      size_t *len)
+{
+    size_t cap = 4096, n = 0;
+    char *buf = malloc(cap + 1);
+    while (buf) {
+        if (n == cap) {
+            if (cap >= limit) {
+                errno = EMSGSIZE;
+                break;
+            }
+            cap = cap * 2 < limit ? cap * 2 : limit;
+            char *tmp = realloc(buf, cap + 1);
+            if (!tmp) break;
+            buf = tmp;
+        }
+        if (wait_ready(fd, POLLIN, deadline) != 0)
+            break;
+        ssize_t r = read(fd, buf + n, cap - n);
+        if (r < 0 && (errno == EINTR ||
+                      (deadline && (errno == EAGAIN || errno == EWOULDBLOCK))))
+            continue;
+        if (r < 0)
+            break;
+        if (r == 0) {
+            buf[n] = '\0';
+            *len = n;
+            return buf;
+        }
+        n += (size_t)r;
+    }
+    int saved = errno;
+    free(buf);
+    errno = saved;
+    return NULL;
+}
+
+static int write_all(int fd, const char *buf, size_t len,
+                     const struct timespec *deadline)
+{
+    while (len > 0) {
+        if (wait_ready(fd, POLLOUT, deadline) != 0)
+            return -1;
+        ssize_t w = write(fd, buf, len);
+        if (w < 0 && (errno == EINTR ||
+                      (deadline && (errno == EAGAIN || errno == EWOULDBLOCK))))
+            continue;
+        if (w <= 0)
+            return -1;
+        buf += w;
+        len -= (size_t)w;
+    }
+    return 0;
+}
+
+/*
+ * parse_query:
+ *   Parse the text header of a request; the board bytes must follow it
+ *   exactly. Returns 0 on success (q->weights is then owned by the
+ *   caller), -1 on a malformed request.
+ */
+static int parse_query(const char *req, size_t len, Query *q) {
+    memset(q, 0, sizeof *q);
+    FILE *f = fmemopen((void *)req, len, "r");
+    if (!f) return -1;
+
+    char magic[32], mode[16], kernel[16];
+    int version, exceed;
+    size_t board_len;
+    int ok =
+        fscanf(f, "%31s %d %15s", magic, &version, mode) == 3 &&
+        strcmp(magic, QUERY_MAGIC) == 0 && version == QUERY_VERSION &&
+        (strcmp(mode, "simulate") == 0 || strcmp(mode, "exact") == 0 ||
+         strcmp(mode, "gradient") == 0) &&
+        fscanf(f, " die %zu %d %15s", &q->sides, &exceed, kernel) == 3 &&
+        q->sides >= 1 && q->sides <= DIE_MAX_SIDES &&
+        sim_kernel_parse(kernel, &q->kernel) == 0 &&
+        fscanf(f, " weights %zu", &q->n_weights) == 1 &&
+        (q->n_weights == 0 || q->n_weights == q->sides);
+    if (ok && q->n_weights) {
+        q->weights = malloc(q->n_weights * sizeof(double));
+        ok = q->weights != NULL;
+        for (size_t i = 0; ok && i < q->n_weights; ++i)
+            ok = fscanf(f, "%lf", &q->weights[i]) == 1;
+    }
+    ok = ok &&
+        fscanf(f, " run %zu %zu %" SCNu64 " %zu %zu",
+               &q->iterations, &q->max_steps, &q->seed,
+               &q->keep.k, &q->keep.m) == 5 &&
+        q->keep.k <= q->iterations && q->keep.m <= q->iterations &&
+        fscanf(f, " board %zu", &board_len) == 1 &&
+        fgetc(f) == '\n';
+    q->keep.seed = q->seed;
+    long pos = ok ? ftell(f) : -1;
+    fclose(f);
+
+    if (!ok || pos < 0 || (size_t)pos + board_len != len) {
+        free(q->weights);
+        q->weights = NULL;
+        return -1;
+    }
+    q->exact         = strcmp(mode, "exact") == 0;
+    q->gradient      = strcmp(mode, "gradient") == 0;
+    q->win_by_exceed = exceed != 0;
+    q->board         = req + pos;
+    q->board_len     = board_len;
+    return 0;
+}
+
+/*
+ * graph_key:
+ *   Cache key of the board a query runs on.
+ */
+static uint64_t graph_key(const Query *q) {
+    uint64_t h = FNV1A_INIT;
+    uint32_t kernel = (uint32_t)q->kernel;
+    h = fnv1a(h, q->board, q->board_len);
+    h = fnv1a(h, &q->sides, sizeof q->sides);
+    h = fnv1a(h, &q->win_by_exceed, sizeof q->win_by_exceed);
+    h = fnv1a(h, &kernel, sizeof kernel);
+    if (q->n_weights)
+        h = fnv1a(h, q->weights, q->n_weights * sizeof(double));
+    return h;
+}
+
+/*
+ * graph_matches:
+ *   Full comparison of a cache entry against a query's inputs.
+ */
+static int graph_matches(const Graph *g, uint64_t key, const Query *q) {
+    return g->key == key &&
+           g->text_len == q->board_len &&
+           g->sides == q->sides &&
+           g->win_by_exceed == q->win_by_exceed &&
+           g->kernel == q->kernel &&
+           g->n_weights == q->n_weights &&
+           memcmp(g->text, q->board, q->board_len) == 0 &&
+           (!q->n_weights ||
+            memcmp(g->weights, q->weights,
+                   q->n_weights * sizeof(double)) == 0);
+}
+
+/*
+ * graph_free:
+ *   Release a Graph and everything it owns.
+ */
+static void graph_free(Graph *g) {
+    if (!g) return;
+    sim_plan_free(g->plan);
+    die_free(g->d);
+    board_free(g->b);
+    free(g->weights);
+    free(g->text);
+    free(g);
+}
+
+/*
+ * graph_build:
+ *   Parse the board text and build graph, die and plan exactly like the
+ *   command-line path in main. Returns NULL with *err set on failure.
+ */
+static Graph *graph_build(uint64_t key, const Query *q, const char **err) {
+    Graph *g = calloc(1, sizeof(Graph));
+    if (!g) {
+        *err = "out of memory";
+        return NULL;
+    }
+    g->key           = key;
+    g->text_len      = q->board_len;
+    g->sides         = q->sides;
+    g->n_weights     = q->n_weights;
+    g->win_by_exceed = q->win_by_exceed;
+    g->kernel        = q->kernel;
+    g->text          = malloc(q->board_len ? q->board_len : 1);
+    if (q->n_weights)
+        g->weights = malloc(q->n_weights * sizeof(double));
+    if (!g->text || (q->n_weights && !g->weights)) {
+        *err = "out of memory";
+        graph_free(g);
+        return NULL;
+    }
+    memcpy(g->text, q->board, q->board_len);
+    if (q->n_weights)
+        memcpy(g->weights, q->weights, q->n_weights * sizeof(double));
+
+    FILE *f = fmemopen(g->text, g->text_len ? g->text_len : 1, "r");
+    if (f) {
+        g->b = board_read(f, "<query>");
+        fclose(f);
+    }
+    if (!g->b) {
+        *err = "invalid board";
+        graph_free(g);
+        return NULL;
+    }
+    if (board_build_graph(g->b, g->sides, g->weights,
+                          g->win_by_exceed) != 0 ||
+        !(g->d = die_create(g->sides, g->weights)) ||
+        !(g->plan = sim_plan_create(g->b, g->d, g->kernel))) {
+        *err = "could not prepare simulation";
+        graph_free(g);
+        return NULL;
+    }
+    return g;
+}
+
+/*
+ * graph_acquire:
+ *   Return the cached graph for the query (taking a reference), building
+ *   and inserting it on a miss. Building runs without the lock; if another
+ *   worker inserted the same graph meanwhile, that one is used instead.
+ *   When the cache is full of graphs in use, the new graph is handed out
+ *   uncached and freed by its last graph_release.
+ */
+static Graph *graph_acquire(Daemon *dm, const Query *q, const char **err) {
+    uint64_t key = graph_key(q);
+
+    pthread_mutex_lock(&dm->lock);
+    for (size_t i = 0; i < dm->n_graphs; ++i) {
+        Graph *g = dm->graphs[i];
+        if (graph_matches(g, key, q)) {
+            g->refs++;
+            g->last_used = ++dm->clock;
+            pthread_mutex_unlock(&dm->lock);
+            return g;
+        }
+    }
+    pthread_mutex_unlock(&dm->lock);
+
+    Graph *fresh = graph_build(key, q, err);
+    if (!fresh) return NULL;
+
+    pthread_mutex_lock(&dm->lock);
+    for (size_t i = 0; i < dm->n_graphs; ++i) {
+        Graph *g = dm->graphs[i];
+        if (graph_matches(g, key, q)) {
+            g->refs++;
+            g->last_used = ++dm->clock;
+            pthread_mutex_unlock(&dm->lock);
+            graph_free(fresh);
+            return g;
+        }
+    }
+    size_t slot = dm->n_graphs;
+    if (slot == DAEMON_MAX_GRAPHS) {
+        /* evict the least recently used graph nobody is using */
+        for (size_t i = 0; i < dm->n_graphs; ++i)
+            if (dm->graphs[i]->refs == 0 &&
+                (slot == DAEMON_MAX_GRAPHS ||
+                 dm->graphs[i]->last_used < dm->graphs[slot]->last_used))
+                slot = i;
+        if (slot < DAEMON_MAX_GRAPHS)
+            graph_free(dm->graphs[slot]);
+    } else {
+        dm->n_graphs++;
+    }
+    fresh->refs      = 1;
+    fresh->last_used = ++dm->clock;
+    if (slot < DAEMON_MAX_GRAPHS) {
+        fresh->cached     = 1;
+        dm->graphs[slot]  = fresh;
+    }
+    pthread_mutex_unlock(&dm->lock);
+    return fresh;
+}
+
+/*
+ * graph_release:
+ *   Drop a reference taken by graph_acquire.
+ */
+static void graph_release(Daemon *dm, Graph *g) {
+    pthread_mutex_lock(&dm->lock);
+    int drop = --g->refs == 0 && !g->cached;
+    pthread_mutex_unlock(&dm->lock);
+    if (drop)
+        graph_free(g);
+}
+
+/*
+ * result_lookup:
+ *   Copy a memoized reply for this exact request, if any.
+ *   Returns a new buffer (length in *len) or NULL.
+ */
+static char *result_lookup(Daemon *dm, const char *req, size_t len,
+                           uint64_t key, size_t *reply_len)
+{
+    char *out = NULL;
+    pthread_mutex_lock(&dm->lock);
+    for (size_t i = 0; i < dm->n_results; ++i) {
+        const Result *r = &dm->results[i];
+        if (r->key == key && r->request_len == len &&
+            memcmp(r->request, req, len) == 0) {
+            out = malloc(r->reply_len);
+            if (out) {
+                memcpy(out, r->reply, r->reply_len);
+                *reply_len = r->reply_len;
+            }
+            break;
+        }
+    }
+    pthread_mutex_unlock(&dm->lock);
+    return out;
+}
+
+/*
+ * result_store:
+ *   Memoize a reply, replacing the oldest one when the ring is full.
+ *   Failure to allocate only means the reply is not memoized.
+ */
+static void result_store(Daemon *dm, const char *req, size_t len,
+                         uint64_t key, const char *reply, size_t reply_len)
+{
+    char *req_copy   = malloc(len);
+    char *reply_copy = malloc(reply_len ? reply_len : 1);
+    if (!req_copy || !reply_copy) {
+        free(req_copy);
+        free(reply_copy);
+        return;
+    }
+    memcpy(req_copy, req, len);
+    memcpy(reply_copy, reply, reply_len);
+
+    pthread_mutex_lock(&dm->lock);
+    Result *r = &dm->results[dm->next_result];
+    free(r->request);
+    free(r->reply);
+    *r = (Result){ key, req_copy, len, reply_copy, reply_len };
+    dm->next_result = (dm->next_result + 1) % DAEMON_MAX_RESULTS;
+    if (dm->n_results < DAEMON_MAX_RESULTS)
+        dm->n_results++;
+    pthread_mutex_unlock(&dm->lock);
+}
+
+/*
+ * run_query:
+ *   Answer a parsed query on a cached graph into a memory stream.
+ *   Returns the output text (length in *len) or NULL with *err set.
+ */
+static char *run_query(Daemon *dm, const Query *q, size_t *len,
+                       const char **err)
+{
+    Graph *g = graph_acquire(dm, q, err);
+    if (!g) return NULL;
+
+    char *text = NULL;
+    FILE *out = open_memstream(&text, len);
+    if (!out) {
+        *err = "out of memory";
+        graph_release(dm, g);
+        return NULL;
+    }
+    int failed = 0;
+    if (q->gradient) {
+        if (markov_fprint_gradient(out, g->b, g->d) != 0) {
+            *err = "could not solve the chain";
+            failed = 1;
+        }
+    } else if (q->exact) {
+        if (markov_fprint(out, g->b, g->d) != 0) {
+            *err = "could not solve the chain";
+            failed = 1;
+        }
+    } else {
+        Stats *st = parallel_run(g->plan, 0, q->iterations, q->max_steps,
+                                 q->seed, 1, q->keep);
+        if (st)
+            stats_fprint(out, st, g->b);
+        else {
+            *err = "simulation failed";
+            failed = 1;
+        }
+        stats_free(st);
+    }
+    graph_release(dm, g);
+
+    if (fclose(out) != 0 && !failed) {
+        *err = "out of memory";
+        failed = 1;
+    }
+    if (failed) {
+        free(text);
+        return NULL;
+    }
+    return text;
+}
+
+/*
+ * serve_connection:
+ *   Read one request, answer it from the memo or by running it, and send
+ *   the reply. Receiving the request and sending the reply each get
+ *   DAEMON_IO_TIMEOUT seconds in total; the run in between is not
+ *   limited. The connection is closed by the caller.
+ */
+static void serve_connection(Daemon *dm, int fd) {
+    size_t len;
+    struct timespec deadline = deadline_in(DAEMON_IO_TIMEOUT);
+    char *req = read_all(fd, DAEMON_MAX_REQUEST, &deadline, &len);
+    if (!req) {
+        const char *msg = errno == EAGAIN
+                        ? "error timeout\n"
+                        : "error request too large or unreadable\n";
+        deadline = deadline_in(DAEMON_IO_TIMEOUT);
+        write_all(fd, msg, strlen(msg), &deadline);
+        return;
+    }
+
+    uint64_t key = fnv1a(FNV1A_INIT, req, len);
+    size_t reply_len = 0;
+    const char *err = NULL;
+    char *reply = result_lookup(dm, req, len, key, &reply_len);
+    if (!reply) {
+        Query q;
+        if (parse_query(req, len, &q) != 0) {
+            err = "malformed request";
+        } else {
+            reply = run_query(dm, &q, &reply_len, &err);
+            free(q.weights);
+            if (reply)
+                result_store(dm, req, len, key, reply, reply_len);
+        }
+    }
+
+    char head[64];
+    deadline = deadline_in(DAEMON_IO_TIMEOUT);
+    if (reply) {
+        int n = snprintf(head, sizeof head, "ok %zu\n", reply_len);
+        if (write_all(fd, head, (size_t)n, &deadline) == 0)
+            write_all(fd, reply, reply_len, &deadline);
+    } else {
+        int n = snprintf(head, sizeof head, "error %s\n", err);
+        write_all(fd, head, (size_t)n, &deadline);
+    }
+    free(reply);
+    free(req);
+}
+
+/*
+ * worker_main:
+ *   Pool thread: take connections off the queue until the daemon stops
+ *   and the queue is drained.
+ */
+static void *worker_main(void *arg) {
+    Daemon *dm = arg;
+    for (;;) {
+        pthread_mutex_lock(&dm->lock);
+        while (dm->count == 0 && !dm->stopping)
+            pthread_cond_wait(&dm->not_empty, &dm->lock);
+        if (dm->count == 0) {
+            pthread_mutex_unlock(&dm->lock);
+            return NULL;
+        }
+        int fd = dm->queue[dm->head];
+        dm->head = (dm->head + 1) % DAEMON_QUEUE;
+        dm->count--;
+        pthread_cond_signal(&dm->not_full);
+        pthread_mutex_unlock(&dm->lock);
+
+        serve_connection(dm, fd);
+        close(fd);
+    }
+}
+
+/*
+ * set_nonblocking:
+ *   Make an accepted connection non-blocking, so read_all and write_all
+ *   wait for it only through poll and never past their deadline.
+ *   Returns 0 on success, -1 on failure.
+ */
+static int set_nonblocking(int fd) {
+    int flags = fcntl(fd, F_GETFL);
+    return flags >= 0 && fcntl(fd, F_SETFL, flags | O_NONBLOCK) == 0
+           ? 0 : -1;
+}
+
+/*
+ * open_listener:
+ *   Create, bind and listen on a Unix domain socket at `path`.
+ *   Returns the socket or -1 after printing an error.
+ */
+static int open_listener(const char *path) {
+    struct sockaddr_un addr;
+    memset(&addr, 0, sizeof addr);
+    addr.sun_family = AF_UNIX;
+    if (strlen(path) >= sizeof addr.sun_path) {
+        fprintf(stderr, "Error: socket path '%s' is too long\n", path);
+        return -1;
+    }
+    strcpy(addr.sun_path, path);
+
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0) {
+        fprintf(stderr, "Error: cannot create socket\n");
+        return -1;
+    }
+    unlink(path);
+    if (bind(fd, (struct sockaddr *)&addr, sizeof addr) != 0 ||
+        listen(fd, DAEMON_QUEUE) != 0) {
+        fprintf(stderr, "Error: cannot listen on '%s'\n", path);
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+/*
+ * daemon_serve:
+ *   The main thread accepts connections and queues them for the pool.
+ *   Signal handlers are installed without SA_RESTART so a pending accept
+ *   returns EINTR on shutdown; queued connections are still answered
+ *   before the workers exit. SIGINT and SIGTERM are blocked in the worker
+ *   threads (they inherit the mask in effect at pthread_create), so the
+ *   signal is always delivered to the main thread and interrupts accept.
+ */
+int daemon_serve(const char *path, size_t workers) {
+    if (workers == 0) workers = 1;
+    int lfd = open_listener(path);
+    if (lfd < 0) return 1;
+
+    struct sigaction sa;
+    memset(&sa, 0, sizeof sa);
+    sa.sa_handler = on_stop;
+    sigemptyset(&sa.sa_mask);
+    sigaction(SIGINT, &sa, NULL);
+    sigaction(SIGTERM, &sa, NULL);
+    /* a client hanging up early must not kill the daemon */
+    signal(SIGPIPE, SIG_IGN);
+
+    Daemon *dm = calloc(1, sizeof(Daemon));
+    pthread_t *tid = calloc(workers, sizeof(pthread_t));
+    if (!dm || !tid) {
+        fprintf(stderr, "Error: out of memory\n");
+        free(dm);
+        free(tid);
+        close(lfd);
+        unlink(path);
+        return 1;
+    }
+    pthread_mutex_init(&dm->lock, NULL);
+    pthread_cond_init(&dm->not_empty, NULL);
+    pthread_cond_init(&dm->not_full, NULL);
+
+    sigset_t stop_set, old_set;
+    sigemptyset(&stop_set);
+    sigaddset(&stop_set, SIGINT);
+    sigaddset(&stop_set, SIGTERM);
+    pthread_sigmask(SIG_BLOCK, &stop_set, &old_set);
+    size_t started = 0;
+    while (started < workers &&
+           pthread_create(&tid[started], NULL, worker_main, dm) == 0)
+        started++;
+    pthread_sigmask(SIG_SETMASK, &old_set, NULL);
+    if (started == 0) {
+        fprintf(stderr, "Error: cannot start worker threads\n");
+        stop_requested = 1;
+    } else {
+        fprintf(stderr, "pfusch: listening on %s with %zu worker(s)\n",
+                path, started);
+    }
+
+    while (!stop_requested) {
+        int fd = accept(lfd, NULL, NULL);
+        if (fd < 0)
+            continue;   /* EINTR on shutdown, or a transient error */
+        if (set_nonblocking(fd) != 0) {
+            close(fd);
+            continue;
+        }
+        pthread_mutex_lock(&dm->lock);
+        /* the handler cannot signal a condition variable: wake up once a
+         * second to see whether a stop was requested */
+        while (dm->count == DAEMON_QUEUE && !stop_requested) {
+            struct timespec t;
+            clock_gettime(CLOCK_REALTIME, &t);
+            t.tv_sec += 1;
+            pthread_cond_timedwait(&dm->not_full, &dm->lock, &t);
+        }
+        if (dm->count == DAEMON_QUEUE) {
+            pthread_mutex_unlock(&dm->lock);
+            close(fd);
+            break;
+        }
+        dm->queue[(dm->head + dm->count) % DAEMON_QUEUE] = fd;
+        dm->count++;
+        pthread_cond_signal(&dm->not_empty);
+        pthread_mutex_unlock(&dm->lock);
+    }
+
+    pthread_mutex_lock(&dm->lock);
+    dm->stopping = 1;
+    pthread_cond_broadcast(&dm->not_empty);
+    pthread_mutex_unlock(&dm->lock);
+    for (size_t t = 0; t < started; ++t)
+        pthread_join(tid[t], NULL);
+    close(lfd);
+    unlink(path);
+
+    for (size_t i = 0; i < dm->n_graphs; ++i)
+        graph_free(dm->graphs[i]);
+    for (size_t i = 0; i < dm->n_results; ++i) {
+        free(dm->results[i].request);
+        free(dm->results[i].reply);
+    }
+    pthread_cond_destroy(&dm->not_full);
+    pthread_cond_destroy(&dm->not_empty);
+    pthread_mutex_destroy(&dm->lock);
+    free(dm);
+    free(tid);
+    return started ? 0 : 1;
+}
+
+/*
+ * read_file:
+ *   Read a whole file into memory. Returns NULL on I/O error.
+ */
+static char *read_file(const char *path, size_t *len) {
+    FILE *f = fopen(path, "rb");
+    if (!f) return NULL;
+    size_t cap = 4096, n = 0;
+    char *buf = malloc(cap);
+    while (buf) {
+        n += fread(buf + n, 1, cap - n, f);
+        if (n < cap) break;
+        char *tmp = realloc(buf, cap * 2);
+        if (!tmp) {
+            free(buf);
+            buf = NULL;
+            break;
+        }
+        buf = tmp;
+        cap *= 2;
+    }
+    if (buf && ferror(f)) {
+        free(buf);
+        buf = NULL;
+    }
+    fclose(f);
+    *len = n;
+    return buf;
+}
+
+/*
+ * daemon_query:
+ *   Build the request in a memory stream, send it, half-close the socket
+ *   and relay the reply.
+ */
+int daemon_query(const char *path, const CLIOptions *opts) {
+    size_t board_len;
+    char *board = read_file(opts->config_file, &board_len);
+    if (!board) {
+        fprintf(stderr, "Error: failed to read board '%s'\n",
+                opts->config_file);
+        return 1;
+    }
+
+    char *req = NULL;
+    size_t req_len = 0;
+    FILE *f = open_memstream(&req, &req_len);
+    if (!f) {
+        free(board);
+        fprintf(stderr, "Error: out of memory\n");
+        return 1;
+    }
+    fprintf(f, "%s %d %s\n", QUERY_MAGIC, QUERY_VERSION,
+            opts->gradient ? "gradient"
+                           : opts->exact ? "exact" : "simulate");
+    fprintf(f, "die %zu %d %s\n", opts->die_sides, opts->win_by_exceed,
+            sim_kernel_name(opts->kernel));
+    fprintf(f, "weights %zu", opts->die_probs ? opts->die_sides : 0);
+    for (size_t i = 0; opts->die_probs && i < opts->die_sides; ++i)
+        fprintf(f, " %.17g", opts->die_probs[i]);
+    fprintf(f, "\nrun %zu %zu %u %zu %zu\n", opts->iterations,
+            opts->max_steps, opts->seed, opts->keep_games,
+            opts->sample_games);
+    fprintf(f, "board %zu\n", board_len);
+    fwrite(board, 1, board_len, f);
+    free(board);
+    if (fclose(f) != 0) {
+        free(req);
+        fprintf(stderr, "Error: out of memory\n");
+        return 1;
+    }
+
+    struct sockaddr_un addr;
+    memset(&addr, 0, sizeof addr);
+    addr.sun_family = AF_UNIX;
+    int fd = -1;
+    if (strlen(path) < sizeof addr.sun_path) {
+        strcpy(addr.sun_path, path);
+        fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    }
+    if (fd < 0 || connect(fd, (struct sockaddr *)&addr, sizeof addr) != 0) {
+        fprintf(stderr, "Error: cannot connect to daemon at '%s'\n", path);
+        if (fd >= 0) close(fd);
+        free(req);
+        return 1;
+    }
+    signal(SIGPIPE, SIG_IGN);
+    int err = write_all(fd, req, req_len, NULL);
+    free(req);
+    shutdown(fd, SHUT_WR);
+
+    size_t len;
+    char *reply = err ? NULL : read_all(fd, SIZE_MAX, NULL, &len);
+    close(fd);
+    if (!reply) {
+        fprintf(stderr, "Error: no reply from daemon at '%s'\n", path);
+        return 1;
+    }
+
+    int rc = 1;
+    size_t body_len;
+    int head;
+    if (sscanf(reply, "ok %zu%n", &body_len, &head) == 1 &&
+        reply[head] == '\n' && (size_t)head + 1 + body_len == len) {
+        fwrite(reply + head + 1, 1, body_len, stdout);
+        rc = 0;
+    } else if (strncmp(reply, "error ", 6) == 0) {
+        fprintf(stderr, "Error: daemon: %s", reply + 6);
+    } else {
+        fprintf(stderr, "Error: malformed reply from daemon\n");
+    }
+    free(reply);
+    return rc;
+}
@@ -0,0 +1,71 @@
+#ifndef DAEMON_H
+#define DAEMON_H
+
+#include <stddef.h>
+
+#include "cli.h"
+
+/*
+ * Query protocol (one request per connection, text header + raw board):
+ *   request:
+ *     pfusch-query 2 <simulate|exact|gradient>
+ *     die <sides> <win_by_exceed> <kernel>
+ *     weights <n> <w1> ... <wn>          (n == 0 for a fair die)
+ *     run <iterations> <max_steps> <seed> <keep> <sample>
+ *                                        (keep, sample <= iterations)
+ *     board <bytes>
+ *     <board file contents, exactly <bytes> bytes>
+ *   The client then shuts down its sending side.
+ *   reply:
+ *     ok <bytes>\n<output, exactly as pfusch would print it>
+ *   or
+ *     error <message>\n
+ *   A client that has not sent its whole request (and shut down its side)
+ *   within DAEMON_IO_TIMEOUT seconds gets "error timeout".
+ */
+
+/*
+ * DAEMON_MAX_GRAPHS / DAEMON_MAX_RESULTS:
+ *   Cached built boards (board + die + plan) and memoized replies. When a
+ *   cache is full the least recently used graph no query is using, or the
+ *   oldest reply, is dropped.
+ * DAEMON_QUEUE:
+ *   Accepted connections waiting for a worker; the accept loop blocks
+ *   while the queue is full.
+ * DAEMON_MAX_REQUEST:
+ *   Largest request accepted, in bytes.
+ * DAEMON_IO_TIMEOUT:
+ *   Seconds a client gets in total to send its request, and again to
+ *   read the reply, before the worker gives up on the connection, so a
+ *   slow or idle client cannot hold a worker forever.
+ */
+#define DAEMON_MAX_GRAPHS  32
+#define DAEMON_MAX_RESULTS 256
+#define DAEMON_QUEUE       64
+#define DAEMON_MAX_REQUEST (16u << 20)
+#define DAEMON_IO_TIMEOUT  10
+
+/*
+ * daemon_serve:
+ *   Listen on the Unix domain socket `path` (an existing socket file there
+ *   is replaced) and answer queries on `workers` threads until SIGINT or
+ *   SIGTERM, then remove the socket file.
+ *   - Boards are cached by a hash of the file contents together with the
+ *     die, its weights, the win rule and the kernel, so repeated queries
+ *     skip board_load, board_build_graph and sim_plan_create.
+ *   - Complete replies are memoized by the full request, so an identical
+ *     query (same seed included) is answered without simulating.
+ *   Returns 0 after a clean shutdown, 1 if the socket could not be set up.
+ */
+int daemon_serve(const char *path, size_t workers);
+
+/*
+ * daemon_query:
+ *   Send the query described by `opts` (board file, die, rules, kernel,
+ *   iterations, steps, seed, retained games, opts->exact and
+ *   opts->gradient) to the daemon at `path` and print its reply to stdout.
+ *   Returns 0 on success, 1 after printing an error.
+ */
+int daemon_query(const char *path, const CLIOptions *opts);
+
+#endif /* DAEMON_H */
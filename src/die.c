@@ -1,8 +1,74 @@
 #include "die.h"
 
+#include <ctype.h>
 #include <stdlib.h>
 #include <string.h>
 
+/*
+ * die_alias_build:
+ *   Vose's alias method: scale every probability by n, then repeatedly
+ *   let an entry below 1 fill the rest of its column from one above 1.
+ *   Zero-weight entries are paired first, while the large entries surely
+ *   have mass left, so rounding can never make them drawable.
+ */
+int die_alias_build(const double *w, size_t n, double *accept,
+                    uint32_t *alias)
+{
+    double total = 0.0;
+    for (size_t i = 0; i < n; ++i)
+        total += w[i];
+    double   *scaled = malloc(n * sizeof(double));
+    uint32_t *small  = malloc(n * sizeof(uint32_t));
+    uint32_t *large  = malloc(n * sizeof(uint32_t));
+    if (!scaled || !small || !large) {
+        free(scaled);
+        free(small);
+        free(large);
+        return -1;
+    }
+
+    size_t n_small = 0, n_large = 0;
+    for (size_t i = 0; i < n; ++i) {
+        scaled[i] = w[i] * (double)n / total;
+        if (scaled[i] >= 1.0)
+            large[n_large++] = (uint32_t)i;
+        else if (w[i] > 0.0)
+            small[n_small++] = (uint32_t)i;
+    }
+    /* zero-weight entries on top of the stack, so they are paired first */
+    for (size_t i = 0; i < n; ++i)
+        if (w[i] <= 0.0)
+            small[n_small++] = (uint32_t)i;
+
+    while (n_small && n_large) {
+        uint32_t s = small[--n_small];
+        uint32_t l = large[n_large - 1];
+        accept[s] = scaled[s];
+        alias[s]  = l;
+        scaled[l] -= 1.0 - scaled[s];
+        if (scaled[l] < 1.0) {
+            n_large--;
+            small[n_small++] = l;
+        }
+    }
+    /* what is left is 1 up to rounding */
+    while (n_large) {
+        uint32_t l = large[--n_large];
+        accept[l] = 1.0;
+        alias[l]  = l;
+    }
+    while (n_small) {
+        uint32_t s = small[--n_small];
+        accept[s] = 1.0;
+        alias[s]  = s;
+    }
+
+    free(scaled);
+    free(small);
+    free(large);
+    return 0;
+}
+
 /*
  * die_create:
  *   Allocate and initialize a Die with the given number of sides.
@@ -10,12 +76,13 @@
  *   - probs: optional array of length `sides` containing weights for each face.
  *     If non-NULL, a copy is made and converted in-place to prefix sums for
  *     weighted random sampling. The prefix sums array has the property that
- *     probs[i] = sum of original weights up to face i.
+ *     probs[i] = sum of original weights up to face i. The alias table for
+ *     sampling is built from the original weights.
  *   - If probs is NULL, the die is fair and rolls will be uniform.
  *   Returns a pointer to the newly allocated Die, or NULL on allocation failure.
  */
 Die *die_create(size_t sides, const double *probs) {
-    Die *d = malloc(sizeof(Die));
+    Die *d = calloc(1, sizeof(Die));
     if (!d) return NULL;
     d->sides = sides;
     if (probs) {
@@ -28,44 +95,149 @@ Die *die_create(size_t sides, const double *probs) {
         /* build prefix sums in-place for weighted sampling */
         for (size_t i = 1; i < sides; ++i)
             d->probs[i] += d->probs[i-1];
-    } else {
-        d->probs = NULL;
+        d->accept = malloc(sides * sizeof(double));
+        d->alias  = malloc(sides * sizeof(uint32_t));
+        if (!d->accept || !d->alias ||
+            die_alias_build(probs, sides, d->accept, d->alias) != 0) {
+            die_free(d);
+            return NULL;
+        }
     }
     return d;
 }
 
+/*
+ * add_dice:
+ *   Convolve the sum distribution dist (*len entries, entry k = P(sum k))
+ *   with `count` fair dice of `faces` faces, one die at a time.
+ *   dist must have room for DIE_MAX_SIDES + 1 entries.
+ *   Returns 0 on success, -1 if the largest sum would exceed DIE_MAX_SIDES
+ *   or allocation fails.
+ */
+static int add_dice(double *dist, size_t *len, size_t count, size_t faces) {
+    if (count > DIE_MAX_SIDES || faces > DIE_MAX_SIDES ||
+        *len - 1 + count * faces > DIE_MAX_SIDES)
+        return -1;
+    double *next = malloc((DIE_MAX_SIDES + 1) * sizeof(double));
+    if (!next) return -1;
+    for (size_t n = 0; n < count; ++n) {
+        size_t out = *len + faces;
+        for (size_t k = 0; k < out; ++k) {
+            double p = 0.0;
+            for (size_t f = 1; f <= faces && f <= k; ++f)
+                if (k - f < *len)
+                    p += dist[k - f];
+            next[k] = p / (double)faces;
+        }
+        memcpy(dist, next, out * sizeof(double));
+        *len = out;
+    }
+    free(next);
+    return 0;
+}
+
+/*
+ * die_dice_weights:
+ *   The distribution starts as "sum 0 with probability 1"; a constant
+ *   shifts it, each die is convolved in with add_dice. Terms are parsed
+ *   with strtoul; whitespace is not allowed.
+ */
+double *die_dice_weights(const char *expr, size_t *sides) {
+    double *dist = calloc(DIE_MAX_SIDES + 1, sizeof(double));
+    if (!dist) return NULL;
+    dist[0] = 1.0;
+    size_t len = 1;  /* dist[len-1] is the largest sum so far */
+
+    const char *p = expr;
+    for (;;) {
+        size_t count = 1;
+        char *end;
+        if (isdigit((unsigned char)*p)) {
+            count = strtoul(p, &end, 10);
+            p = end;
+        } else if (*p != 'd') {
+            goto fail;
+        }
+        if (*p == 'd') {
+            if (!isdigit((unsigned char)p[1]))
+                goto fail;
+            size_t faces = strtoul(p + 1, &end, 10);
+            p = end;
+            if (count == 0 || faces == 0 ||
+                add_dice(dist, &len, count, faces) != 0)
+                goto fail;
+        } else {
+            /* constant: shift every sum up by count */
+            if (count > DIE_MAX_SIDES || len - 1 + count > DIE_MAX_SIDES)
+                goto fail;
+            memmove(dist + count, dist, len * sizeof(double));
+            memset(dist, 0, count * sizeof(double));
+            len += count;
+        }
+        if (*p == '\0')
+            break;
+        if (*p++ != '+')
+            goto fail;
+    }
+
+    /* a die has no face 0: the smallest sum must be at least 1 */
+    if (len < 2 || dist[0] > 0.0)
+        goto fail;
+    *sides = len - 1;
+    memmove(dist, dist + 1, *sides * sizeof(double));
+    return dist;
+
+fail:
+    free(dist);
+    return NULL;
+}
+
 /*
  * die_roll:
  *   Roll the die and return a face value in the range [1 .. sides].
+ *   - All randomness comes from rng, so a caller that owns one generator per
+ *     game gets reproducible rolls independent of any other game.
  *   - If no probability array is set (d->probs == NULL), returns a uniform
  *     random integer between 1 and sides inclusive.
- *   - If a prefix-sum array is present, generates a uniform random double in
- *     [0, total_weight), then finds the first index i such that r <= probs[i]
- *     and returns i+1 as the face.
+ *   - Otherwise picks a uniform column of the alias table and keeps its own
+ *     face with probability accept[column], else takes its alias; faces
+ *     with zero weight always have accept 0 and are never returned.
  */
-size_t die_roll(Die *d) {
+size_t die_roll(const Die *d, Rng *rng) {
     if (!d->probs) {
         /* fair die */
-        return (rand() % d->sides) + 1;
+        return (size_t)rng_below(rng, (uint32_t)d->sides) + 1;
     }
     /* weighted die */
-    double r = ((double)rand() / RAND_MAX) * d->probs[d->sides - 1];
-    for (size_t i = 0; i < d->sides; ++i) {
-        if (r <= d->probs[i])
-            return i + 1;
-    }
-    /* fallback: should not happen, but return highest face */
-    return d->sides;
+    uint32_t c = rng_below(rng, (uint32_t)d->sides);
+    return rng_double(rng) < d->accept[c] ? (size_t)c + 1
+                                          : (size_t)d->alias[c] + 1;
+}
+
+/*
+ * die_face_prob:
+ *   - Fair die: 1 / sides.
+ *   - Weighted die: difference of neighbouring prefix sums divided by the
+ *     total weight.
+ */
+double die_face_prob(const Die *d, size_t face) {
+    if (!d->probs)
+        return 1.0 / (double)d->sides;
+    double lo = face > 1 ? d->probs[face - 2] : 0.0;
+    return (d->probs[face - 1] - lo) / d->probs[d->sides - 1];
 }
 
 /*
  * die_free:
  *   Free a Die object and its associated resources.
- *   - Frees the internal probability array (if any) and the Die struct itself.
+ *   - Frees the internal probability and alias arrays (if any) and the Die
+ *     struct itself.
  *   - Safe to call with a NULL pointer.
  */
 void die_free(Die *d) {
     if (!d) return;
     free(d->probs);
+    free(d->accept);
+    free(d->alias);
     free(d);
 }
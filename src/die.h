@@ -2,17 +2,32 @@
 #define DIE_H
 
 #include <stddef.h>
+#include <stdint.h>
+
+#include "rng.h"
+
+/*
+ * DIE_MAX_SIDES:
+ *   Largest number of faces a die (or largest sum of a dice expression)
+ *   may have.
+ */
+#define DIE_MAX_SIDES 1024
 
 /*
  * Die:
  *   Represents a die with a specified number of faces.
  *   - sides: number of faces on the die.
  *   - probs: NULL for a fair (uniform) die; otherwise an array of length `sides`
- *            containing prefix sums for weighted random sampling.
+ *            containing prefix sums of the face weights.
+ *   - accept, alias: alias table of a weighted die (NULL for a fair one):
+ *            a roll picks a uniform column c and returns face c+1 with
+ *            probability accept[c], face alias[c]+1 otherwise.
  */
 typedef struct {
     size_t sides;
     double *probs;    /* NULL for uniform, otherwise length == sides */
+    double *accept;   /* NULL for uniform, otherwise length == sides */
+    uint32_t *alias;  /* NULL for uniform, otherwise length == sides */
 } Die;
 
 /*
@@ -21,19 +36,53 @@ typedef struct {
  *   - sides: number of faces on the die.
  *   - probs: optional array of length `sides` with weights for each face.
  *     If NULL, the die will be fair; otherwise, a copy is made and converted
- *     in-place to prefix sums for weighted sampling.
+ *     in-place to prefix sums, and the alias table for sampling is built.
  *   Returns a pointer to the newly allocated Die, or NULL on allocation failure.
  */
 Die *die_create(size_t sides, const double *probs /* NULL for uniform */);
 
+/*
+ * die_alias_build:
+ *   Fill an alias table for drawing an index in [0, n) with probability
+ *   proportional to w[i] (weights need not be normalized; their sum must
+ *   be positive): pick a uniform column c, keep c with probability
+ *   accept[c], otherwise take alias[c]. Entries with zero weight are never
+ *   drawn. accept and alias must have room for n entries.
+ *   Returns 0 on success, -1 on allocation failure.
+ */
+int die_alias_build(const double *w, size_t n, double *accept,
+                    uint32_t *alias);
+
+/*
+ * die_dice_weights:
+ *   Parse a dice expression and return the distribution of its sum, to be
+ *   used as the face weights of a single die (face k = a sum of k).
+ *   - expr: terms joined by '+', each either "<n>d<s>" (n dice with s
+ *           faces, n defaults to 1) or a constant "<c>",
+ *           e.g. "2d6", "3d4", "2d6+1d4", "d8+2".
+ *   - sides: receives the largest possible sum.
+ *   Returns a new array of *sides probabilities (0 for sums below the
+ *   smallest possible), or NULL if the expression is malformed, its largest
+ *   sum exceeds DIE_MAX_SIDES, or allocation fails.
+ */
+double *die_dice_weights(const char *expr, size_t *sides);
+
 /*
  * die_roll:
  *   Roll the die and return a face value in the range [1 .. sides].
+ *   - rng: generator to draw from; the die itself holds no random state.
  *   - For a fair die (probs == NULL), returns a uniform random integer.
- *   - For a weighted die, generates a random double in [0, total_weight)
- *     then returns the first face whose prefix sum exceeds that value.
+ *   - For a weighted die, draws one alias-table column and one uniform
+ *     double, so a roll costs O(1) whatever the number of faces.
+ */
+size_t die_roll(const Die *d, Rng *rng);
+
+/*
+ * die_face_prob:
+ *   Return the probability of rolling `face` (1..sides), normalized so all
+ *   faces sum to 1. Used to precompute transition probabilities.
  */
-size_t die_roll(Die *d);
+double die_face_prob(const Die *d, size_t face);
 
 /*
  * die_free:
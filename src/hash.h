@@ -0,0 +1,27 @@
+#ifndef HASH_H
+#define HASH_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * FNV1A_INIT:
+ *   Offset basis of the 64-bit FNV-1a hash.
+ */
+#define FNV1A_INIT 0xcbf29ce484222325ULL
+
+/*
+ * fnv1a:
+ *   Fold `len` bytes into a running 64-bit FNV-1a hash (start from
+ *   FNV1A_INIT). Used for run fingerprints and cache keys, not security.
+ */
+static inline uint64_t fnv1a(uint64_t h, const void *data, size_t len) {
+    const unsigned char *p = data;
+    for (size_t i = 0; i < len; ++i) {
+        h ^= p[i];
+        h *= 0x100000001b3ULL;
+    }
+    return h;
+}
+
+#endif /* HASH_H */
@@ -1,21 +1,311 @@
 #include "cli.h"
 #include "board.h"
+#include "daemon.h"
 #include "die.h"
+#include "markov.h"
+#include "parallel.h"
+#include "pipeline.h"
 #include "sim.h"
 #include "stats.h"
+#include "shard.h"
+#include "trace.h"
 
 #include <stdlib.h>
 #include <stdio.h>
 
+/*
+ * retain_spec:
+ *   Example games to keep, from --keep and --sample.
+ */
+static RetainSpec retain_spec(const CLIOptions *opts) {
+    return (RetainSpec){ opts->keep_games, opts->sample_games, opts->seed };
+}
+
+/*
+ * run_shard:
+ *   Run one shard of the game range (a fresh one, or the rest of a resumed
+ *   checkpoint), streaming games into the trace file if requested.
+ *   Returns the shard's statistics, or NULL after printing an error.
+ */
+static Stats *run_shard(const CLIOptions *opts, const SimPlan *plan,
+                        uint64_t fp)
+{
+    const Board *b = plan->b;
+    const char *ckpt = opts->checkpoint_file
+                     ? opts->checkpoint_file
+                     : opts->resume_file;
+    if (!ckpt && opts->shard_count > 1) {
+        fprintf(stderr,
+                "Error: --shard needs --checkpoint to store its result\n");
+        return NULL;
+    }
+    if (opts->threads > 1) {
+        fprintf(stderr, "Error: -j cannot be combined with --shard, "
+                        "--checkpoint or --resume\n");
+        return NULL;
+    }
+    if (opts->resume_file && opts->trace_file) {
+        fprintf(stderr, "Error: --trace cannot be combined with --resume\n");
+        return NULL;
+    }
+
+    Shard *sh;
+    if (opts->resume_file) {
+        sh = shard_load(b, opts->resume_file);
+        if (!sh) {
+            fprintf(stderr, "Error: cannot read checkpoint '%s'\n",
+                    opts->resume_file);
+            return NULL;
+        }
+        if (sh->fingerprint != fp) {
+            fprintf(stderr,
+                    "Error: checkpoint '%s' was run with a different "
+                    "board, die or step limit\n", opts->resume_file);
+            shard_free(sh);
+            return NULL;
+        }
+    } else {
+        sh = shard_create(b, opts->seed, opts->iterations, opts->max_steps,
+                          fp, opts->shard_index, opts->shard_count,
+                          retain_spec(opts));
+        if (!sh) {
+            fprintf(stderr, "Error: could not create shard\n");
+            return NULL;
+        }
+    }
+
+    TraceWriter *tw = NULL;
+    if (opts->trace_file) {
+        tw = trace_create(opts->trace_file, opts->die_sides, b->size,
+                          sh->first);
+        if (!tw) {
+            fprintf(stderr, "Error: cannot create trace '%s'\n",
+                    opts->trace_file);
+            shard_free(sh);
+            return NULL;
+        }
+    }
+
+    int err = shard_run(sh, plan, ckpt, opts->checkpoint_every, tw);
+    if (tw && trace_close(tw) != 0 && !err) {
+        fprintf(stderr, "Error: failed writing trace '%s'\n",
+                opts->trace_file);
+        err = -1;
+    }
+    if (err) {
+        fprintf(stderr, "Error: simulation failed\n");
+        shard_free(sh);
+        return NULL;
+    }
+
+    Stats *st = sh->st;
+    sh->st = NULL;
+    shard_free(sh);
+    return st;
+}
+
+/*
+ * run_all:
+ *   Simulate every game in memory, then compute statistics over the results.
+ *   With -j, the games are spread over threads that accumulate statistics
+ *   directly instead; both paths retain the same --keep/--sample games.
+ *   Returns the statistics, or NULL after printing an error.
+ */
+static Stats *run_all(const CLIOptions *opts, const SimPlan *plan) {
+    if (opts->threads > 1) {
+        Stats *st = parallel_run(plan, 0, opts->iterations, opts->max_steps,
+                                 opts->seed, opts->threads,
+                                 retain_spec(opts));
+        if (!st)
+            fprintf(stderr, "Error: simulation failed\n");
+        return st;
+    }
+
+    Simulation *sim = simulate_many(plan,
+                                    opts->iterations,
+                                    opts->max_steps,
+                                    opts->seed);
+    if (!sim) {
+        fprintf(stderr, "Error: simulation failed\n");
+        return NULL;
+    }
+
+    Stats *st = stats_compute(plan->b, sim, retain_spec(opts));
+    sim_free(sim);
+    if (!st)
+        fprintf(stderr, "Error: could not compute statistics\n");
+    return st;
+}
+
+/*
+ * run_pipeline:
+ *   Simulate on opts->threads workers while statistics (and the trace, if
+ *   requested) are produced concurrently, with optional progress output.
+ *   Returns the statistics, or NULL after printing an error.
+ */
+static Stats *run_pipeline(const CLIOptions *opts, const SimPlan *plan) {
+    TraceWriter *tw = NULL;
+    if (opts->trace_file) {
+        tw = trace_create(opts->trace_file, opts->die_sides, plan->b->size, 0);
+        if (!tw) {
+            fprintf(stderr, "Error: cannot create trace '%s'\n",
+                    opts->trace_file);
+            return NULL;
+        }
+    }
+
+    Stats *st = pipeline_run(plan, opts->iterations, opts->max_steps,
+                             opts->seed, opts->threads, retain_spec(opts),
+                             tw, opts->progress_secs);
+    if (tw && trace_close(tw) != 0 && st) {
+        fprintf(stderr, "Error: failed writing trace '%s'\n",
+                opts->trace_file);
+        stats_free(st);
+        return NULL;
+    }
+    if (!st)
+        fprintf(stderr, "Error: simulation failed\n");
+    return st;
+}
+
+/*
+ * write_heatmap:
+ *   Solve the exact expected landings per square and write them next to
+ *   the simulated occupancy. Returns 0 on success, 1 on error.
+ */
+static int write_heatmap(const char *path, const Stats *st,
+                         const Board *b, const Die *d)
+{
+    double *expected = markov_expected_visits(b, d);
+    if (!expected) {
+        fprintf(stderr, "Error: could not solve expected visits\n");
+        return 1;
+    }
+    FILE *f = fopen(path, "w");
+    if (!f) {
+        fprintf(stderr, "Error: cannot write heatmap '%s'\n", path);
+        free(expected);
+        return 1;
+    }
+    int err = stats_write_heatmap(f, st, b, expected);
+    if (fclose(f) != 0 || err) {
+        fprintf(stderr, "Error: failed writing heatmap '%s'\n", path);
+        free(expected);
+        return 1;
+    }
+    free(expected);
+    return 0;
+}
+
+/*
+ * open_trace:
+ *   Map a trace for analysis and check it was recorded on this board with
+ *   this die size. Returns NULL after printing an error.
+ */
+static TraceReader *open_trace(const char *path, const Board *b,
+                               size_t die_sides)
+{
+    TraceReader *tr = trace_open(path);
+    if (!tr) {
+        fprintf(stderr, "Error: cannot read trace '%s'\n", path);
+        return NULL;
+    }
+    if (tr->board_size != b->size || tr->die_sides != die_sides) {
+        fprintf(stderr,
+                "Error: trace '%s' was recorded on a %llu-square board "
+                "with a d%llu\n", path,
+                (unsigned long long)tr->board_size,
+                (unsigned long long)tr->die_sides);
+        trace_close_reader(tr);
+        return NULL;
+    }
+    return tr;
+}
+
+/*
+ * replay_trace:
+ *   Print one recorded game roll by roll with the square reached after
+ *   each roll. Returns 0 on success, 1 on error.
+ */
+static int replay_trace(const CLIOptions *opts, const Board *b) {
+    TraceReader *tr = open_trace(opts->trace_replay_file, b, opts->die_sides);
+    if (!tr) return 1;
+
+    size_t *seq = NULL, cap = 0, end;
+    size_t rolls = trace_game(tr, opts->trace_replay_game, &seq, &cap, &end);
+    if (rolls == (size_t)-1) {
+        fprintf(stderr, "Error: game %zu is not in trace '%s'\n",
+                opts->trace_replay_game, opts->trace_replay_file);
+        trace_close_reader(tr);
+        return 1;
+    }
+
+    if (rolls == 0 && b->dead[end])
+        printf("Game %zu: stuck in dead square %zu\n",
+               opts->trace_replay_game, end);
+    else if (rolls == 0)
+        printf("Game %zu: aborted on square %zu (step limit reached)\n",
+               opts->trace_replay_game, end);
+    else
+        printf("Game %zu (%zu rolls):\n", opts->trace_replay_game, rolls);
+    size_t pos = 0;
+    for (size_t i = 0; i < rolls; ++i) {
+        size_t raw  = pos + seq[i];
+        size_t next = b->adj[pos][seq[i] - 1];
+        const char *via = "";
+        if (raw < b->size && b->mapping[raw] != raw)
+            via = b->mapping[raw] > raw ? "  (ladder)" : "  (snake)";
+        printf("  %5zu: rolled %zu  %3zu -> %-3zu%s\n",
+               i + 1, seq[i], pos, next, via);
+        pos = next;
+    }
+
+    free(seq);
+    trace_close_reader(tr);
+    return 0;
+}
+
+/*
+ * free_options:
+ *   Release the strings and arrays parse_cli allocated.
+ */
+static void free_options(CLIOptions *opts) {
+    free(opts->config_file);
+    free(opts->checkpoint_file);
+    free(opts->resume_file);
+    free(opts->trace_file);
+    free(opts->trace_stats_file);
+    free(opts->trace_replay_file);
+    free(opts->heatmap_file);
+    free(opts->daemon_socket);
+    free(opts->query_socket);
+    free(opts->die_probs);
+}
+
 /*
  * main:
  *   Entry point for the board game simulation program.
  *   - Parses command-line options into a CLIOptions struct.
- *   - Seeds the RNG.
+ *   - With --daemon, serves queries until stopped; with --query, hands the
+ *     run to a daemon and prints its reply.
  *   - Loads the board configuration and builds its graph.
- *   - Creates a Die (with optional weighted faces).
- *   - Runs the specified number of simulations, each up to a maximum number of steps.
- *   - Computes statistics over all simulations and prints the results.
+ *   - Creates a Die (with optional weighted faces) and the simulation plan
+ *     (kernel selection and its precomputed tables).
+ *   - With --exact or --gradient, prints the exact Markov-chain results
+ *     (and sensitivities).
+ *   - With --trace-replay, prints one recorded game and exits.
+ *   - With --trace-stats, recomputes statistics from a recorded trace.
+ *   - With --merge, combines finished shard files.
+ *   - With --shard/--checkpoint/--resume, streams (the rest of) one shard
+ *     game by game, saving checkpoints and/or a trace.
+ *   - With --trace or --progress, pipelines simulation, statistics and
+ *     trace writing on concurrent threads.
+ *   - Otherwise runs the specified number of simulations in memory (or on
+ *     opts.threads threads), each up to a maximum number of steps, seeded
+ *     from opts.seed.
+ *   - Prints the resulting statistics (with the games retained by --keep
+ *     and --sample) and, with --heatmap, writes the
+ *     simulated and exact per-square occupancy grids.
  *   - Cleans up all allocated resources before exiting.
  *   Returns 0 on success, or 1 if any step fails.
  */
@@ -23,8 +313,13 @@ int main(int argc, char **argv) {
     CLIOptions opts;
     parse_cli(argc, argv, &opts);
 
-    /* seed rng */
-    srand(opts.seed);
+    if (opts.daemon_socket || opts.query_socket) {
+        int rc = opts.daemon_socket
+               ? daemon_serve(opts.daemon_socket, opts.threads)
+               : daemon_query(opts.query_socket, &opts);
+        free_options(&opts);
+        return rc;
+    }
 
     /* load and build board */
     Board *b = board_load(opts.config_file);
@@ -33,7 +328,12 @@ int main(int argc, char **argv) {
                 opts.config_file);
         return 1;
     }
-    board_build_graph(b, opts.die_sides, opts.win_by_exceed);
+    if (board_build_graph(b, opts.die_sides, opts.die_probs,
+                          opts.win_by_exceed) != 0) {
+        fprintf(stderr, "Error: out of memory building board graph\n");
+        board_free(b);
+        return 1;
+    }
 
     /* create die */
     Die *d = die_create(opts.die_sides, opts.die_probs);
@@ -43,27 +343,70 @@ int main(int argc, char **argv) {
         return 1;
     }
 
-    /* run simulation */
-    Simulation *sim = simulate_many(b, d,
-                                    opts.iterations,
-                                    opts.max_steps);
-    if (!sim) {
-        fprintf(stderr, "Error: simulation failed\n");
+    /* precompute kernel tables once for the whole run */
+    SimPlan *plan = sim_plan_create(b, d, opts.kernel);
+    if (!plan) {
+        fprintf(stderr, "Error: could not prepare simulation\n");
         die_free(d);
         board_free(b);
         return 1;
     }
 
-    /* compute & print stats */
-    Stats *st = stats_compute(b, sim);
-    stats_print(st, b);
+    int rc = 0;
+    Stats *st = NULL;
+    uint64_t fp = shard_fingerprint(plan, opts.max_steps);
+
+    if (opts.trace_replay_file) {
+        rc = replay_trace(&opts, b);
+    }
+    else if (opts.gradient) {
+        if (markov_fprint_gradient(stdout, b, d) != 0) {
+            fprintf(stderr, "Error: could not solve the Markov chain\n");
+            rc = 1;
+        }
+    }
+    else if (opts.exact) {
+        if (markov_fprint(stdout, b, d) != 0) {
+            fprintf(stderr, "Error: could not solve the Markov chain\n");
+            rc = 1;
+        }
+    }
+    else {
+        if (opts.trace_stats_file) {
+            TraceReader *tr = open_trace(opts.trace_stats_file, b,
+                                         opts.die_sides);
+            if (tr) {
+                st = trace_stats(tr, b, retain_spec(&opts));
+                if (!st)
+                    fprintf(stderr, "Error: trace '%s' is corrupt\n",
+                            opts.trace_stats_file);
+                trace_close_reader(tr);
+            }
+        }
+        else if (opts.n_merge > 0)
+            st = shard_merge(b, fp, opts.merge_files, opts.n_merge);
+        else if (opts.shard_count > 1 || opts.checkpoint_file ||
+                 opts.resume_file)
+            st = run_shard(&opts, plan, fp);
+        else if (opts.trace_file || opts.progress_secs > 0)
+            st = run_pipeline(&opts, plan);
+        else
+            st = run_all(&opts, plan);
+
+        /* print stats */
+        if (st)
+            stats_print(st, b);
+        else
+            rc = 1;
+        if (st && opts.heatmap_file)
+            rc = write_heatmap(opts.heatmap_file, st, b, d);
+    }
 
     /* clean up */
     stats_free(st);
-    sim_free(sim);
+    sim_plan_free(plan);
     die_free(d);
     board_free(b);
-    free(opts.config_file);
-    free(opts.die_probs);
-    return 0;
+    free_options(&opts);
+    return rc;
 }
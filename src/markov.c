@@ -0,0 +1,376 @@
+#include "markov.h"
+
+#include <math.h>
+#include <stdlib.h>
+
+/*
+ * face_probs:
+ *   Return a new array with the normalized probability of every face
+ *   (index f holds face f+1), or NULL on allocation failure.
+ */
+static double *face_probs(const Die *d) {
+    double *p = malloc(d->sides * sizeof(double));
+    if (!p) return NULL;
+    for (size_t f = 0; f < d->sides; ++f)
+        p[f] = die_face_prob(d, f + 1);
+    return p;
+}
+
+/*
+ * markov_win_prob:
+ *   Solves h[i] = sum_f p_f h[adj[i][f]] with h = 1 on the last square and
+ *   h = 0 on dead squares. Self-loops (rolls that stay put) are moved to
+ *   the left-hand side, and sweeps run from the last square backwards so
+ *   values flow toward the start within a single sweep.
+ *   - The divisor is the summed probability of the faces that move, not
+ *     1 - stay, which cancels to 0 when those faces are rare.
+ *   Returns NULL on allocation failure, no convergence or a non-finite
+ *   value.
+ */
+double *markov_win_prob(const Board *b, const Die *d) {
+    size_t n = b->size;
+    size_t sides = d->sides;
+    double *h = malloc(n * sizeof(double));
+    double *p = face_probs(d);
+    if (!h || !p) {
+        free(h);
+        free(p);
+        return NULL;
+    }
+    for (size_t i = 0; i < n; ++i)
+        h[i] = b->dead[i] ? 0.0 : 1.0;
+
+    size_t sweep;
+    for (sweep = 0; sweep < MARKOV_MAX_SWEEPS; ++sweep) {
+        double delta = 0.0;
+        for (size_t i = n - 1; i-- > 0; ) {
+            if (b->dead[i])
+                continue;
+            double move = 0.0, acc = 0.0;
+            for (size_t f = 0; f < sides; ++f) {
+                size_t j = b->adj[i][f];
+                if (j != i) {
+                    move += p[f];
+                    acc  += p[f] * h[j];
+                }
+            }
+            double v = acc / move;
+            if (!(move > 0.0) || !isfinite(v))
+                goto fail;
+            delta = fmax(delta, fabs(v - h[i]));
+            h[i] = v;
+        }
+        if (delta <= MARKOV_TOLERANCE)
+            break;
+    }
+    if (sweep < MARKOV_MAX_SWEEPS) {
+        free(p);
+        return h;
+    }
+fail:
+    free(p);
+    free(h);
+    return NULL;
+}
+
+/*
+ * transient:
+ *   Whether square i is a transient state of the chain: not the goal and
+ *   not absorbing. With win probabilities h, squares the game cannot be won
+ *   from are absorbing; without (h == NULL), dead squares are.
+ */
+static int transient(const Board *b, const double *h, size_t i) {
+    if (i == b->size - 1)
+        return 0;
+    return h ? h[i] > 0.0 : !b->dead[i];
+}
+
+/*
+ * solve_visits:
+ *   Expected time spent on every transient square, counting time 0 on the
+ *   start: x_j = [j == 0] + sum_i x_i q_ij over transient i, j, with
+ *   q_ij = p_ij h_j / h_i (the chain conditioned on winning) or q = p if
+ *   h is NULL. The incoming edges of every square are gathered in
+ *   compressed form (offsets + sources + weights) and the system is swept
+ *   front to back, dividing by the summed probability of the faces that
+ *   leave a square (1 - stay cancels to 0 when they are rare). Entries of
+ *   absorbing squares are left at 0.
+ *   Returns 0 on success, -1 on allocation failure, no convergence or a
+ *   non-finite value.
+ */
+static int solve_visits(const Board *b, const double *p, size_t sides,
+                        const double *h, double *x)
+{
+    size_t n = b->size;
+    double *move  = calloc(n, sizeof(double));
+    size_t *start = calloc(n + 1, sizeof(size_t));
+    size_t *src   = malloc(n * sides * sizeof(size_t));
+    double *w     = malloc(n * sides * sizeof(double));
+    size_t *fill  = malloc(n * sizeof(size_t));
+    int rc = -1;
+    if (!move || !start || !src || !w || !fill)
+        goto done;
+
+    /* count incoming edges between transient squares, then scatter */
+    for (size_t i = 0; i < n; ++i) {
+        if (!transient(b, h, i))
+            continue;
+        for (size_t f = 0; f < sides; ++f) {
+            size_t j = b->adj[i][f];
+            if (p[f] == 0.0 || j == i)
+                continue;
+            move[i] += p[f];
+            if (transient(b, h, j))
+                start[j + 1]++;
+        }
+    }
+    for (size_t i = 0; i < n; ++i)
+        start[i + 1] += start[i];
+    for (size_t i = 0; i < n; ++i)
+        fill[i] = start[i];
+    for (size_t i = 0; i < n; ++i) {
+        if (!transient(b, h, i))
+            continue;
+        for (size_t f = 0; f < sides; ++f) {
+            size_t j = b->adj[i][f];
+            if (p[f] == 0.0 || j == i || !transient(b, h, j))
+                continue;
+            src[fill[j]] = i;
+            w[fill[j]++] = h ? p[f] * h[j] / h[i] : p[f];
+        }
+    }
+
+    for (size_t sweep = 0; sweep < MARKOV_MAX_SWEEPS; ++sweep) {
+        int converged = 1;
+        for (size_t j = 0; j < n; ++j) {
+            if (!transient(b, h, j))
+                continue;
+            double acc = (j == 0) ? 1.0 : 0.0;
+            for (size_t e = start[j]; e < start[j + 1]; ++e)
+                acc += x[src[e]] * w[e];
+            double v = acc / move[j];
+            if (!(move[j] > 0.0) || !isfinite(v))
+                goto done;
+            if (fabs(v - x[j]) > MARKOV_TOLERANCE * v)
+                converged = 0;
+            x[j] = v;
+        }
+        if (converged) {
+            rc = 0;
+            break;
+        }
+    }
+
+done:
+    free(move);
+    free(start);
+    free(src);
+    free(w);
+    free(fill);
+    return rc;
+}
+
+/*
+ * markov_expected_visits:
+ *   solve_visits on the chain conditioned on winning. A roll "lands" on a
+ *   square at every visit except the initial one on the start, and on the
+ *   goal exactly once.
+ */
+double *markov_expected_visits(const Board *b, const Die *d) {
+    size_t n = b->size;
+    double *h = markov_win_prob(b, d);
+    double *p = face_probs(d);
+    double *x = calloc(n, sizeof(double));
+    if (!h || !p || !x) {
+        free(h);
+        free(p);
+        free(x);
+        return NULL;
+    }
+    if (h[0] > 0.0) {
+        if (solve_visits(b, p, d->sides, h, x) != 0) {
+            free(x);
+            x = NULL;
+        } else {
+            if (n > 1)
+                x[0] -= 1.0;
+            x[n - 1] = 1.0;
+        }
+    }
+    free(h);
+    free(p);
+    return x;
+}
+
+/*
+ * solve_rolls:
+ *   Expected rolls until the game ends: t_i = 1 + sum_f p_f t[adj[i][f]]
+ *   on transient squares, 0 on the goal and dead squares. Swept from the
+ *   last square backwards like markov_win_prob, dividing by the summed
+ *   probability of the faces that move.
+ *   Returns 0 on success, -1 if the solve did not converge or a value is
+ *   not finite.
+ */
+static int solve_rolls(const Board *b, const double *p, size_t sides,
+                       double *t)
+{
+    size_t n = b->size;
+    for (size_t i = 0; i < n; ++i)
+        t[i] = 0.0;
+    for (size_t sweep = 0; sweep < MARKOV_MAX_SWEEPS; ++sweep) {
+        int converged = 1;
+        for (size_t i = n; i-- > 0; ) {
+            if (!transient(b, NULL, i))
+                continue;
+            double move = 0.0, acc = 1.0;
+            for (size_t f = 0; f < sides; ++f) {
+                size_t j = b->adj[i][f];
+                if (j != i) {
+                    move += p[f];
+                    acc  += p[f] * t[j];
+                }
+            }
+            double v = acc / move;
+            if (!(move > 0.0) || !isfinite(v))
+                return -1;
+            if (fabs(v - t[i]) > MARKOV_TOLERANCE * v)
+                converged = 0;
+            t[i] = v;
+        }
+        if (converged)
+            return 0;
+    }
+    return -1;
+}
+
+/*
+ * markov_gradient:
+ *   With Q the transient part of the chain, t = 1 + Q t and the adjoint
+ *   lambda = e_0 + Q^T lambda (expected visits from the start), so for any
+ *   parameter theta
+ *     dT/dtheta = lambda^T (dQ/dtheta) t.
+ *   - Face f: every square i has Q[i][adj[i][f]] += 1 per unit of p_f, so
+ *     dT/dp_f = sum_i lambda_i t[adj[i][f]].
+ *   - Jump s -> e with presence theta: a roll landing on s moves on to e
+ *     with probability theta and stays on s otherwise, so
+ *     dT/dtheta = (t_e - t_s) * sum of lambda_i p_f over the rolls that
+ *     land on s. t_s is well defined because the adjacency of a jump
+ *     start is built like any other square's.
+ */
+MarkovGradient *markov_gradient(const Board *b, const Die *d) {
+    size_t n = b->size;
+    size_t sides = d->sides;
+    MarkovGradient *g = calloc(1, sizeof(MarkovGradient));
+    double *p      = face_probs(d);
+    double *t      = malloc(n * sizeof(double));
+    double *lambda = calloc(n, sizeof(double));
+    if (!g || !p || !t || !lambda)
+        goto fail;
+    g->sides   = sides;
+    g->n_jumps = b->n_jumps;
+    g->d_face  = calloc(sides, sizeof(double));
+    g->d_jump  = calloc(b->n_jumps ? b->n_jumps : 1, sizeof(double));
+    if (!g->d_face || !g->d_jump)
+        goto fail;
+
+    if (solve_rolls(b, p, sides, t) != 0 ||
+        (transient(b, NULL, 0) &&
+         solve_visits(b, p, sides, NULL, lambda) != 0))
+        goto fail;
+    g->expected_rolls = t[0];
+
+    for (size_t i = 0; i < n; ++i) {
+        if (lambda[i] == 0.0)
+            continue;
+        for (size_t f = 0; f < sides; ++f) {
+            size_t j = b->adj[i][f];
+            g->d_face[f] += lambda[i] * t[j];
+
+            size_t raw = i + f + 1;
+            if (raw >= n || b->mapping[raw] == raw || j != b->mapping[raw])
+                continue;
+            for (size_t k = 0; k < b->n_jumps; ++k)
+                if (b->jumps[k].start == raw && b->jumps[k].end == j)
+                    g->d_jump[k] += lambda[i] * p[f] * (t[j] - t[raw]);
+        }
+    }
+
+    free(p);
+    free(t);
+    free(lambda);
+    return g;
+
+fail:
+    free(p);
+    free(t);
+    free(lambda);
+    markov_gradient_free(g);
+    return NULL;
+}
+
+/*
+ * markov_gradient_free:
+ *   Release a MarkovGradient and its arrays.
+ */
+void markov_gradient_free(MarkovGradient *g) {
+    if (!g) return;
+    free(g->d_face);
+    free(g->d_jump);
+    free(g);
+}
+
+/*
+ * markov_fprint:
+ *   The expected roll count is the sum of the expected landings, which
+ *   counts exactly one landing per roll.
+ */
+int markov_fprint(FILE *out, const Board *b, const Die *d) {
+    double *h = markov_win_prob(b, d);
+    double *v = markov_expected_visits(b, d);
+    if (!h || !v) {
+        free(h);
+        free(v);
+        return -1;
+    }
+    double rolls = 0.0;
+    for (size_t i = 0; i < b->size; ++i)
+        rolls += v[i];
+    fprintf(out, "Expected rolls to win (exact): %.4f\n", rolls);
+    fprintf(out, "Probability of winning:        %.6f\n", h[0]);
+    free(h);
+    free(v);
+    return 0;
+}
+
+/*
+ * markov_fprint_gradient:
+ *   A weight change dw_f moves the normalized probabilities by
+ *   (dw_f - p_f * sum(dw)) / W, so dT/dw_f = (dT/dp_f - sum_g p_g dT/dp_g) / W
+ *   with W the total weight; a fair die has W = sides (all weights 1).
+ */
+int markov_fprint_gradient(FILE *out, const Board *b, const Die *d) {
+    MarkovGradient *g = markov_gradient(b, d);
+    if (!g) return -1;
+
+    double total = d->probs ? d->probs[d->sides - 1] : (double)d->sides;
+    double mean  = 0.0;
+    for (size_t f = 0; f < g->sides; ++f)
+        mean += die_face_prob(d, f + 1) * g->d_face[f];
+
+    fprintf(out, "Expected rolls until the game ends (exact): %.4f\n",
+            g->expected_rolls);
+    fprintf(out, "\nSensitivity to the die:\n");
+    fprintf(out, "  face   prob      dT/dp       dT/dweight\n");
+    for (size_t f = 0; f < g->sides; ++f)
+        fprintf(out, "  %4zu   %.4f  %+11.4f  %+11.4f\n",
+                f + 1, die_face_prob(d, f + 1), g->d_face[f],
+                (g->d_face[f] - mean) / total);
+
+    fprintf(out, "\nSensitivity to each jump (dT/dpresence):\n");
+    for (size_t k = 0; k < b->n_jumps; ++k)
+        fprintf(out, "  %3zu→%-3zu : %+11.4f\n",
+                b->jumps[k].start, b->jumps[k].end, g->d_jump[k]);
+
+    markov_gradient_free(g);
+    return 0;
+}
@@ -0,0 +1,101 @@
+#ifndef MARKOV_H
+#define MARKOV_H
+
+#include <stddef.h>
+#include <stdio.h>
+
+#include "board.h"
+#include "die.h"
+
+/*
+ * Exact quantities of the absorbing Markov chain defined by a built board
+ * and a die: state = square, one transition per roll along b->adj, the
+ * last square absorbing. Dead squares are absorbing as well (the game is
+ * lost there). The linear systems are solved with Gauss-Seidel sweeps over
+ * the sparse transitions, so memory stays O(size * sides).
+ */
+
+/*
+ * MARKOV_TOLERANCE / MARKOV_MAX_SWEEPS:
+ *   A solve stops once no entry changed by more than MARKOV_TOLERANCE
+ *   (relative) in a sweep; it fails after MARKOV_MAX_SWEEPS sweeps.
+ */
+#define MARKOV_TOLERANCE  1e-13
+#define MARKOV_MAX_SWEEPS 1000000
+
+/*
+ * markov_win_prob:
+ *   Probability of ever reaching the last square from each square
+ *   (1 on boards without dead squares, 0 on dead squares).
+ *   Returns a new array of b->size entries, or NULL on allocation failure
+ *   or if the solve did not converge.
+ */
+double *markov_win_prob(const Board *b, const Die *d);
+
+/*
+ * markov_expected_visits:
+ *   Expected number of rolls that end on each square in a game that is
+ *   won, i.e. the exact counterpart of the simulated occupancy divided by
+ *   the number of wins. The chain is conditioned on winning (each
+ *   transition i -> j reweighted by P(win from j) / P(win from i)), so
+ *   games lost in dead squares do not bias the result. The entries sum to
+ *   the expected number of rolls of a won game; the last square gets 1.
+ *   All entries are 0 if the game cannot be won from square 0.
+ *   Returns a new array of b->size entries, or NULL on allocation failure
+ *   or if a solve did not converge.
+ */
+double *markov_expected_visits(const Board *b, const Die *d);
+
+/*
+ * MarkovGradient:
+ *   Expected game length and its sensitivities.
+ *   - expected_rolls: T, the expected number of rolls until the game ends
+ *                     (won, or stuck in a dead square) from square 0.
+ *   - d_face:         sides entries, dT/dp_f for the probability of face
+ *                     f+1, all other probabilities held fixed.
+ *   - d_jump:         n_jumps entries, dT/dtheta_k where theta_k is the
+ *                     probability that jump k is taken when its start is
+ *                     reached (1 = present, 0 = removed).
+ */
+typedef struct {
+    double  expected_rolls;
+    size_t  sides;
+    double *d_face;
+    size_t  n_jumps;
+    double *d_jump;
+} MarkovGradient;
+
+/*
+ * markov_gradient:
+ *   Solve for the expected rolls from every square, then one adjoint
+ *   system (the expected visits of every square), and combine the two
+ *   into all face and jump sensitivities at once.
+ *   Returns a new MarkovGradient, or NULL on allocation failure or if a
+ *   solve did not converge.
+ */
+MarkovGradient *markov_gradient(const Board *b, const Die *d);
+
+/*
+ * markov_gradient_free:
+ *   Free a MarkovGradient. Safe to call with a NULL pointer.
+ */
+void markov_gradient_free(MarkovGradient *g);
+
+/*
+ * markov_fprint:
+ *   Print the exact expected number of rolls of a won game and the
+ *   probability of winning from the start to `out`.
+ *   Returns 0 on success, -1 if a solve failed.
+ */
+int markov_fprint(FILE *out, const Board *b, const Die *d);
+
+/*
+ * markov_fprint_gradient:
+ *   Print T, the face sensitivities (per probability, and per unit of the
+ *   -p weight as given, which accounts for renormalization) and the jump
+ *   sensitivities to `out`.
+ *   Returns 0 on success, -1 if the gradient could not be computed.
+ */
+int markov_fprint_gradient(FILE *out, const Board *b, const Die *d);
+
+#endif /* MARKOV_H */
@@ -0,0 +1,114 @@
+#include "parallel.h"
+
+#include <pthread.h>
+#include <stdlib.h>
+
+/*
+ * Worker:
+ *   Arguments and result of one thread.
+ *   - first, last: game range [first, last) of this thread.
+ *   - st:          the thread's private accumulator.
+ *   - err:         non-zero if the thread ran out of memory.
+ */
+typedef struct {
+    const SimPlan *plan;
+    size_t         first, last;
+    size_t         max_steps;
+    uint64_t       seed;
+    Stats         *st;
+    int            err;
+} Worker;
+
+/*
+ * worker_main:
+ *   Thread body: play the slice game by game into the worker's Stats.
+ */
+static void *worker_main(void *arg) {
+    Worker *w = arg;
+    const Board *b = w->plan->b;
+    size_t *buffer = malloc((w->max_steps ? w->max_steps : 1)
+                            * sizeof(size_t));
+    if (!buffer) {
+        w->err = 1;
+        return NULL;
+    }
+    for (size_t i = w->first; i < w->last; ++i) {
+        Rng rng;
+        rng_seed(&rng, w->seed, i);
+        size_t end;
+        size_t r = sim_plan_play(w->plan, &rng, buffer, w->max_steps, &end);
+        if (stats_add_game(w->st, b, i, buffer, r, end) != 0) {
+            w->err = 1;
+            break;
+        }
+    }
+    free(buffer);
+    return NULL;
+}
+
+/*
+ * parallel_run:
+ *   Slices are split like shards (sizes differ by at most one game).
+ *   Accumulators are created up front on the calling thread; each one's
+ *   counters live in their own heap blocks, the occupancy counters on
+ *   separate cache lines (see stats_create).
+ */
+Stats *parallel_run(const SimPlan *plan, size_t first, size_t last,
+                    size_t max_steps, uint64_t seed, size_t threads,
+                    RetainSpec keep)
+{
+    if (threads == 0) threads = 1;
+    size_t games = last - first;
+
+    Worker    *w   = calloc(threads, sizeof(Worker));
+    pthread_t *tid = calloc(threads, sizeof(pthread_t));
+    Stats     *out = stats_create(plan->b, keep);
+    if (!w || !tid || !out) {
+        free(w);
+        free(tid);
+        stats_free(out);
+        return NULL;
+    }
+
+    size_t started = 0;
+    int err = 0;
+    for (size_t t = 0; t < threads; ++t) {
+        w[t].plan      = plan;
+        w[t].first     = first + games / threads * t
+                       + games % threads * t / threads;
+        w[t].last      = first + games / threads * (t + 1)
+                       + games % threads * (t + 1) / threads;
+        w[t].max_steps = max_steps;
+        w[t].seed      = seed;
+        w[t].st        = stats_create(plan->b, keep);
+        if (!w[t].st) {
+            err = 1;
+            break;
+        }
+        /* a single slice runs on the calling thread */
+        if (threads == 1) {
+            worker_main(&w[t]);
+        } else if (pthread_create(&tid[t], NULL, worker_main, &w[t]) != 0) {
+            err = 1;
+            break;
+        }
+        started++;
+    }
+
+    for (size_t t = 0; t < started; ++t) {
+        if (threads > 1)
+            pthread_join(tid[t], NULL);
+        if (w[t].err || stats_merge(out, w[t].st, plan->b) != 0)
+            err = 1;
+    }
+    for (size_t t = 0; t < threads; ++t)
+        stats_free(w[t].st);
+    free(w);
+    free(tid);
+
+    if (err) {
+        stats_free(out);
+        return NULL;
+    }
+    return out;
+}
@@ -0,0 +1,29 @@
+#ifndef PARALLEL_H
+#define PARALLEL_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "sim.h"
+#include "stats.h"
+
+/*
+ * parallel_run:
+ *   Play games [first, last) with `plan` on `threads` POSIX threads.
+ *   - Thread t takes the t-th contiguous slice of the range and folds its
+ *     games into its own Stats as they finish, so threads never write to
+ *     shared counters while playing.
+ *   - Game i rolls from RNG stream (seed, i) on whatever thread plays it,
+ *     and the per-thread accumulators are merged once all threads joined;
+ *     the result is identical to a single-threaded run.
+ *   - Every thread retains the example games described by `keep`; the
+ *     merged examples are the same as a single-threaded run's too.
+ *   - threads == 1 plays on the calling thread.
+ *   Returns a new Stats, or NULL if a thread could not be started or ran
+ *   out of memory.
+ */
+Stats *parallel_run(const SimPlan *plan, size_t first, size_t last,
+                    size_t max_steps, uint64_t seed, size_t threads,
+                    RetainSpec keep);
+
+#endif /* PARALLEL_H */
@@ -0,0 +1,341 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include "pipeline.h"
+#include "bitpack.h"
+#include "spsc.h"
+
+#include <pthread.h>
+#include <sched.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+/*
+ * Batch:
+ *   Summaries of up to PIPELINE_BATCH_GAMES consecutive games.
+ *   - owner:  worker the batch returns to once every stage is done with it.
+ *   - first:  global index of the first game.
+ *   - rolls, end: per game, as returned by sim_plan_play.
+ *   - faces:  bit-packed faces of the won games, back to back
+ *             (faces_len bytes used of faces_cap).
+ */
+typedef struct {
+    size_t   owner;
+    size_t   first;
+    size_t   n_games;
+    size_t   rolls[PIPELINE_BATCH_GAMES];
+    size_t   end[PIPELINE_BATCH_GAMES];
+    uint8_t *faces;
+    size_t   faces_len, faces_cap;
+} Batch;
+
+/*
+ * Pipeline:
+ *   Shared run state.
+ *   - full[k]:  worker k -> aggregator.
+ *   - out:      aggregator -> trace writer.
+ *   - spare[k]: last stage (writer, or aggregator without a trace) ->
+ *               worker k.
+ *   - failed:   set by any stage that cannot continue; every wait loop
+ *               checks it so the other stages stop too.
+ */
+typedef struct {
+    const SimPlan *plan;
+    size_t         iterations, max_steps;
+    uint64_t       seed;
+    size_t         n_workers, n_batches;
+    unsigned       face_bits;
+    SpscRing      *full, *spare, *out;
+    TraceWriter   *trace;
+    atomic_int     failed;
+} Pipeline;
+
+/*
+ * WorkerArg:
+ *   Thread argument of a simulation worker.
+ */
+typedef struct {
+    Pipeline *p;
+    size_t    k;
+} WorkerArg;
+
+/*
+ * backoff:
+ *   Called while a ring is empty or full: spin briefly, then yield, then
+ *   sleep, so a stage that waits on a slower one stops burning its core.
+ */
+static void backoff(unsigned *spins) {
+    if (++*spins < 64)
+        return;
+    if (*spins < 256) {
+        sched_yield();
+        return;
+    }
+    struct timespec ts = { 0, 50000 };
+    nanosleep(&ts, NULL);
+}
+
+/*
+ * take / give:
+ *   Blocking pop and push on a ring. take returns NULL and give returns -1
+ *   once the pipeline has failed.
+ */
+static void *take(Pipeline *p, SpscRing *r) {
+    unsigned spins = 0;
+    for (;;) {
+        void *item = spsc_pop(r);
+        if (item) return item;
+        if (atomic_load_explicit(&p->failed, memory_order_relaxed))
+            return NULL;
+        backoff(&spins);
+    }
+}
+
+static int give(Pipeline *p, SpscRing *r, void *item) {
+    unsigned spins = 0;
+    while (!spsc_push(r, item)) {
+        if (atomic_load_explicit(&p->failed, memory_order_relaxed))
+            return -1;
+        backoff(&spins);
+    }
+    return 0;
+}
+
+/*
+ * batch_game:
+ *   Unpack the faces of game g of a batch into seq; *pos walks the packed
+ *   bytes and must start at 0 for g == 0. Returns the roll count.
+ */
+static size_t batch_game(const Batch *bt, size_t g, unsigned bits,
+                         size_t *pos, size_t *seq)
+{
+    size_t rolls = bt->rolls[g];
+    if (rolls)
+        *pos += unpack_faces(seq, bt->faces + *pos, rolls, bits);
+    return rolls;
+}
+
+/*
+ * worker_main:
+ *   Play every n_workers-th batch, starting with batch k.
+ */
+static void *worker_main(void *arg) {
+    Pipeline *p = ((WorkerArg *)arg)->p;
+    size_t k    = ((WorkerArg *)arg)->k;
+    size_t *seq = malloc((p->max_steps ? p->max_steps : 1) * sizeof(size_t));
+    if (!seq) {
+        atomic_store(&p->failed, 1);
+        return NULL;
+    }
+
+    for (size_t j = k; j < p->n_batches; j += p->n_workers) {
+        Batch *bt = take(p, &p->spare[k]);
+        if (!bt) break;
+        bt->first     = j * PIPELINE_BATCH_GAMES;
+        bt->n_games   = p->iterations - bt->first < PIPELINE_BATCH_GAMES
+                      ? p->iterations - bt->first
+                      : PIPELINE_BATCH_GAMES;
+        bt->faces_len = 0;
+        for (size_t g = 0; g < bt->n_games; ++g) {
+            Rng rng;
+            rng_seed(&rng, p->seed, bt->first + g);
+            size_t r = sim_plan_play(p->plan, &rng, seq, p->max_steps,
+                                     &bt->end[g]);
+            bt->rolls[g] = r;
+            if (r == 0)
+                continue;
+            size_t need = bt->faces_len + packed_bytes(r, p->face_bits);
+            if (need > bt->faces_cap) {
+                size_t cap = bt->faces_cap * 2 > need
+                           ? bt->faces_cap * 2 : need;
+                uint8_t *tmp = realloc(bt->faces, cap);
+                if (!tmp) {
+                    atomic_store(&p->failed, 1);
+                    free(seq);
+                    return NULL;
+                }
+                bt->faces     = tmp;
+                bt->faces_cap = cap;
+            }
+            bt->faces_len += pack_faces(bt->faces + bt->faces_len, seq, r,
+                                        p->face_bits);
+        }
+        if (give(p, &p->full[k], bt) != 0)
+            break;
+    }
+    free(seq);
+    return NULL;
+}
+
+/*
+ * writer_main:
+ *   Trace stage: write every batch in order, then return it to its worker.
+ */
+static void *writer_main(void *arg) {
+    Pipeline *p = arg;
+    size_t *seq = malloc((p->max_steps ? p->max_steps : 1) * sizeof(size_t));
+    if (!seq) {
+        atomic_store(&p->failed, 1);
+        return NULL;
+    }
+    for (size_t j = 0; j < p->n_batches; ++j) {
+        Batch *bt = take(p, p->out);
+        if (!bt) break;
+        size_t pos = 0;
+        for (size_t g = 0; g < bt->n_games; ++g) {
+            size_t r = batch_game(bt, g, p->face_bits, &pos, seq);
+            if (trace_write_game(p->trace, seq, r, bt->end[g]) != 0) {
+                atomic_store(&p->failed, 1);
+                free(seq);
+                return NULL;
+            }
+        }
+        if (give(p, &p->spare[bt->owner], bt) != 0)
+            break;
+    }
+    free(seq);
+    return NULL;
+}
+
+/*
+ * now_secs:
+ *   Monotonic clock in seconds.
+ */
+static double now_secs(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/*
+ * aggregate:
+ *   Statistics stage, run on the calling thread: fold batches into st in
+ *   game order, printing progress snapshots along the way.
+ *   Returns 0 on success, -1 on failure (of this or another stage).
+ */
+static int aggregate(Pipeline *p, Stats *st, double progress_secs) {
+    const Board *b = p->plan->b;
+    size_t *seq = malloc((p->max_steps ? p->max_steps : 1) * sizeof(size_t));
+    if (!seq) return -1;
+
+    double start = now_secs();
+    double next_report = start + progress_secs;
+    for (size_t j = 0; j < p->n_batches; ++j) {
+        Batch *bt = take(p, &p->full[j % p->n_workers]);
+        if (!bt) break;
+        size_t pos = 0;
+        for (size_t g = 0; g < bt->n_games; ++g) {
+            size_t r = batch_game(bt, g, p->face_bits, &pos, seq);
+            if (stats_add_game(st, b, bt->first + g, seq, r,
+                               bt->end[g]) != 0) {
+                free(seq);
+                return -1;
+            }
+        }
+        SpscRing *next = p->trace ? p->out : &p->spare[bt->owner];
+        if (give(p, next, bt) != 0)
+            break;
+
+        if (progress_secs > 0 && now_secs() >= next_report) {
+            double t = now_secs();
+            fprintf(stderr,
+                    "progress: %zu/%zu games (%5.1f%%), avg %.2f rolls, "
+                    "%.0f games/s\n",
+                    st->games, p->iterations,
+                    100.0 * st->games / (double)p->iterations,
+                    st->avg_rolls, st->games / (t - start));
+            next_report = t + progress_secs;
+        }
+    }
+    free(seq);
+    return st->games == p->iterations ? 0 : -1;
+}
+
+/*
+ * pipeline_run:
+ *   Rings are cache-line aligned (see SpscRing); batches are allocated up
+ *   front and placed in their worker's spare ring before any thread starts.
+ */
+Stats *pipeline_run(const SimPlan *plan, size_t iterations, size_t max_steps,
+                    uint64_t seed, size_t threads, RetainSpec keep,
+                    TraceWriter *trace, double progress_secs)
+{
+    if (threads == 0) threads = 1;
+    Pipeline p = {
+        .plan       = plan,
+        .iterations = iterations,
+        .max_steps  = max_steps,
+        .seed       = seed,
+        .n_workers  = threads,
+        .n_batches  = (iterations + PIPELINE_BATCH_GAMES - 1)
+                    / PIPELINE_BATCH_GAMES,
+        .face_bits  = bits_for_sides(plan->d->sides),
+        .trace      = trace,
+    };
+    atomic_init(&p.failed, 0);
+
+    size_t n_batch = threads * PIPELINE_BATCHES;
+    p.full  = aligned_alloc(64, threads * sizeof(SpscRing));
+    p.spare = aligned_alloc(64, threads * sizeof(SpscRing));
+    p.out   = aligned_alloc(64, sizeof(SpscRing));
+    Batch     *batches = calloc(n_batch, sizeof(Batch));
+    WorkerArg *args    = calloc(threads, sizeof(WorkerArg));
+    pthread_t *tid     = calloc(threads, sizeof(pthread_t));
+    Stats     *st      = stats_create(plan->b, keep);
+    if (!p.full || !p.spare || !p.out || !batches || !args || !tid || !st) {
+        stats_free(st);
+        st = NULL;
+        goto done;
+    }
+
+    spsc_init(p.out);
+    for (size_t k = 0; k < threads; ++k) {
+        spsc_init(&p.full[k]);
+        spsc_init(&p.spare[k]);
+        for (size_t i = 0; i < PIPELINE_BATCHES; ++i) {
+            Batch *bt = &batches[k * PIPELINE_BATCHES + i];
+            bt->owner = k;
+            spsc_push(&p.spare[k], bt);
+        }
+    }
+
+    pthread_t writer;
+    int have_writer = trace &&
+                      pthread_create(&writer, NULL, writer_main, &p) == 0;
+    if (trace && !have_writer)
+        atomic_store(&p.failed, 1);
+
+    size_t started = 0;
+    for (size_t k = 0; k < threads && !atomic_load(&p.failed); ++k) {
+        args[k] = (WorkerArg){ &p, k };
+        if (pthread_create(&tid[k], NULL, worker_main, &args[k]) != 0) {
+            atomic_store(&p.failed, 1);
+            break;
+        }
+        started++;
+    }
+
+    if (atomic_load(&p.failed) || aggregate(&p, st, progress_secs) != 0)
+        atomic_store(&p.failed, 1);
+    for (size_t k = 0; k < started; ++k)
+        pthread_join(tid[k], NULL);
+    if (have_writer)
+        pthread_join(writer, NULL);
+    if (atomic_load(&p.failed)) {
+        stats_free(st);
+        st = NULL;
+    }
+
+done:
+    for (size_t i = 0; batches && i < n_batch; ++i)
+        free(batches[i].faces);
+    free(batches);
+    free(args);
+    free(tid);
+    free(p.full);
+    free(p.spare);
+    free(p.out);
+    return st;
+}
@@ -0,0 +1,41 @@
+#ifndef PIPELINE_H
+#define PIPELINE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "sim.h"
+#include "stats.h"
+#include "trace.h"
+
+/*
+ * PIPELINE_BATCH_GAMES:
+ *   Games per batch handed from a simulation worker to the next stage.
+ * PIPELINE_BATCHES:
+ *   Batches owned by each worker. A worker that has all of them in flight
+ *   waits until a later stage hands one back, which bounds memory and
+ *   throttles simulation to the speed of the slowest stage
+ *   (at most SPSC_CAPACITY).
+ */
+#define PIPELINE_BATCH_GAMES 1024
+#define PIPELINE_BATCHES     8
+
+/*
+ * pipeline_run:
+ *   Play games [0, iterations) on `threads` simulation workers while the
+ *   calling thread accumulates statistics and, if `trace` is non-NULL, a
+ *   writer thread streams the games to the trace, all concurrently.
+ *   - Batch j (games j*B .. j*B+B-1) is played by worker j % threads and
+ *     travels through a lock-free single-producer/single-consumer ring per
+ *     worker, so the aggregator and writer see games in index order and
+ *     the statistics and trace equal those of a sequential run.
+ *   - keep: example games to retain (see stats_create).
+ *   - progress_secs > 0: print a progress line to stderr at most this
+ *     often while the run is going.
+ *   Returns a new Stats, or NULL on allocation or trace write failure.
+ */
+Stats *pipeline_run(const SimPlan *plan, size_t iterations, size_t max_steps,
+                    uint64_t seed, size_t threads, RetainSpec keep,
+                    TraceWriter *trace, double progress_secs);
+
+#endif /* PIPELINE_H */
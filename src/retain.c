@@ -0,0 +1,356 @@
+#include "retain.h"
+
+#include <inttypes.h>
+#include <stdlib.h>
+#include <string.h>
+
+/*
+ * Order:
+ *   How a heap (or a printed list) ranks its games. BY_INDEX is only used
+ *   to print the sample in game order.
+ */
+typedef enum { BY_SHORT, BY_LONG, BY_KEY, BY_INDEX } Order;
+
+/*
+ * worse:
+ *   Non-zero if `a` ranks below `b` under order o, i.e. would be dropped
+ *   first. Equal ranks fall back to the game index (higher is worse).
+ */
+static int worse(Order o, const Sample *a, const Sample *b) {
+    switch (o) {
+    case BY_SHORT:
+        if (a->rolls != b->rolls) return a->rolls > b->rolls;
+        break;
+    case BY_LONG:
+        if (a->rolls != b->rolls) return a->rolls < b->rolls;
+        break;
+    case BY_KEY:
+        if (a->key != b->key) return a->key > b->key;
+        break;
+    case BY_INDEX:
+        break;
+    }
+    return a->index > b->index;
+}
+
+/*
+ * mix:
+ *   splitmix64 finalizer, a bijection on 64-bit values.
+ */
+static uint64_t mix(uint64_t z) {
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+    return z ^ (z >> 31);
+}
+
+/*
+ * sample_key:
+ *   Hash of the game index salted with the run's seed. For a fixed seed
+ *   it is a bijection of the index, so keys never tie, and it does not
+ *   depend on how the game played out.
+ */
+static uint64_t sample_key(uint64_t seed, size_t index) {
+    return mix(mix(seed + 0x9e3779b97f4a7c15ULL) ^ (uint64_t)index);
+}
+
+/*
+ * store:
+ *   Copy game `g` with faces `seq` into slot s, reusing its buffer.
+ *   Returns 0 on success, -1 on allocation failure (s is unchanged).
+ */
+static int store(Sample *s, const Sample *g, const size_t *seq) {
+    if (g->rolls > s->cap) {
+        size_t *tmp = realloc(s->seq, g->rolls * sizeof(size_t));
+        if (!tmp) return -1;
+        s->seq = tmp;
+        s->cap = g->rolls;
+    }
+    if (g->rolls)
+        memcpy(s->seq, seq, g->rolls * sizeof(size_t));
+    s->index = g->index;
+    s->rolls = g->rolls;
+    s->end   = g->end;
+    s->key   = g->key;
+    return 0;
+}
+
+/*
+ * swap:
+ *   Exchange two heap slots (buffers move with their games).
+ */
+static void swap(Sample *a, Sample *b) {
+    Sample t = *a;
+    *a = *b;
+    *b = t;
+}
+
+/*
+ * offer:
+ *   Keep game g in heap h (*n entries, at most cap) if it is not full, or
+ *   if g outranks the root, which it then replaces.
+ *   Slots at and beyond *n are either untouched (zeroed by calloc) or
+ *   were never handed out, so a failed store leaves the heap valid.
+ *   Returns 0 on success, -1 on allocation failure.
+ */
+static int offer(Sample *h, size_t *n, size_t cap, Order o,
+                 const Sample *g, const size_t *seq)
+{
+    if (*n < cap) {
+        if (store(&h[*n], g, seq) != 0) return -1;
+        size_t i = (*n)++;
+        while (i > 0 && worse(o, &h[i], &h[(i - 1) / 2])) {
+            swap(&h[i], &h[(i - 1) / 2]);
+            i = (i - 1) / 2;
+        }
+        return 0;
+    }
+    if (cap == 0 || !worse(o, &h[0], g))
+        return 0;
+    if (store(&h[0], g, seq) != 0) return -1;
+    size_t i = 0;
+    for (;;) {
+        size_t c = 2 * i + 1;
+        if (c >= *n) break;
+        if (c + 1 < *n && worse(o, &h[c + 1], &h[c]))
+            c++;
+        if (!worse(o, &h[c], &h[i])) break;
+        swap(&h[i], &h[c]);
+        i = c;
+    }
+    return 0;
+}
+
+/*
+ * retain_create:
+ *   The heaps are allocated at full size up front; their sequences grow
+ *   on demand up to the longest game stored in each slot.
+ */
+Retain *retain_create(RetainSpec spec) {
+    Retain *r = calloc(1, sizeof(Retain));
+    if (!r) return NULL;
+    r->spec     = spec;
+    r->shortest = calloc(spec.k ? spec.k : 1, sizeof(Sample));
+    r->longest  = calloc(spec.k ? spec.k : 1, sizeof(Sample));
+    r->sample   = calloc(spec.m ? spec.m : 1, sizeof(Sample));
+    if (!r->shortest || !r->longest || !r->sample) {
+        retain_free(r);
+        return NULL;
+    }
+    return r;
+}
+
+/*
+ * retain_add:
+ *   Wins are offered to both length heaps, every game to the sample; the
+ *   faces are only copied into slots that keep the game.
+ */
+int retain_add(Retain *r, size_t index, const size_t *seq, size_t rolls,
+               size_t end)
+{
+    Sample g = { index, rolls, end, sample_key(r->spec.seed, index),
+                 NULL, 0 };
+    if (rolls &&
+        (offer(r->shortest, &r->n_shortest, r->spec.k, BY_SHORT,
+               &g, seq) != 0 ||
+         offer(r->longest, &r->n_longest, r->spec.k, BY_LONG,
+               &g, seq) != 0))
+        return -1;
+    return offer(r->sample, &r->n_sample, r->spec.m, BY_KEY, &g, seq);
+}
+
+/*
+ * retain_merge:
+ *   Heap by heap: src's k shortest wins contain every src win that can
+ *   be among the k shortest of the union, and likewise for the others.
+ */
+int retain_merge(Retain *dst, const Retain *src) {
+    for (size_t i = 0; i < src->n_shortest; ++i)
+        if (offer(dst->shortest, &dst->n_shortest, dst->spec.k, BY_SHORT,
+                  &src->shortest[i], src->shortest[i].seq) != 0)
+            return -1;
+    for (size_t i = 0; i < src->n_longest; ++i)
+        if (offer(dst->longest, &dst->n_longest, dst->spec.k, BY_LONG,
+                  &src->longest[i], src->longest[i].seq) != 0)
+            return -1;
+    for (size_t i = 0; i < src->n_sample; ++i)
+        if (offer(dst->sample, &dst->n_sample, dst->spec.m, BY_KEY,
+                  &src->sample[i], src->sample[i].seq) != 0)
+            return -1;
+    return 0;
+}
+
+/*
+ * write_games:
+ *   One line per game: game <index> <rolls> <end> <face>...
+ */
+static void write_games(FILE *f, const Sample *h, size_t n) {
+    for (size_t i = 0; i < n; ++i) {
+        fprintf(f, "game %zu %zu %zu", h[i].index, h[i].rolls, h[i].end);
+        for (size_t j = 0; j < h[i].rolls; ++j)
+            fprintf(f, " %zu", h[i].seq[j]);
+        fprintf(f, "\n");
+    }
+}
+
+/*
+ * retain_write:
+ *   Layout:
+ *     retain <k> <m> <seed> <n_shortest> <n_longest> <n_sample>
+ *   followed by the games of each heap, in that order (see write_games).
+ */
+int retain_write(FILE *f, const Retain *r) {
+    fprintf(f, "retain %zu %zu %" PRIu64 " %zu %zu %zu\n", r->spec.k,
+            r->spec.m, r->spec.seed, r->n_shortest, r->n_longest,
+            r->n_sample);
+    write_games(f, r->shortest, r->n_shortest);
+    write_games(f, r->longest, r->n_longest);
+    write_games(f, r->sample, r->n_sample);
+    return ferror(f) ? -1 : 0;
+}
+
+/*
+ * read_games:
+ *   Parse n game lines and offer each to heap h. *buf, of *cap entries,
+ *   is a scratch buffer for the faces that grows as needed.
+ *   Returns 0 on success, -1 on malformed input or allocation failure.
+ */
+static int read_games(FILE *f, size_t n, Sample *h, size_t *n_h,
+                      size_t cap_h, Order o, uint64_t seed, size_t **buf,
+                      size_t *cap)
+{
+    for (size_t i = 0; i < n; ++i) {
+        Sample g = { 0 };
+        if (fscanf(f, " game %zu %zu %zu", &g.index, &g.rolls, &g.end) != 3)
+            return -1;
+        if (g.rolls > *cap) {
+            size_t *tmp = realloc(*buf, g.rolls * sizeof(size_t));
+            if (!tmp) return -1;
+            *buf = tmp;
+            *cap = g.rolls;
+        }
+        for (size_t j = 0; j < g.rolls; ++j)
+            if (fscanf(f, "%zu", &(*buf)[j]) != 1)
+                return -1;
+        g.key = sample_key(seed, g.index);
+        if (offer(h, n_h, cap_h, o, &g, *buf) != 0)
+            return -1;
+    }
+    return 0;
+}
+
+/*
+ * retain_read:
+ *   Heaps may hold at most k (or m) games; the keys are recomputed from
+ *   the seed and the indices rather than stored.
+ */
+Retain *retain_read(FILE *f) {
+    RetainSpec spec;
+    size_t n_shortest, n_longest, n_sample;
+    if (fscanf(f, " retain %zu %zu %" SCNu64 " %zu %zu %zu", &spec.k,
+               &spec.m, &spec.seed, &n_shortest, &n_longest,
+               &n_sample) != 6 ||
+        n_shortest > spec.k || n_longest > spec.k || n_sample > spec.m)
+        return NULL;
+
+    Retain *r = retain_create(spec);
+    if (!r) return NULL;
+    size_t *buf = NULL, cap = 0;
+    if (read_games(f, n_shortest, r->shortest, &r->n_shortest, spec.k,
+                   BY_SHORT, spec.seed, &buf, &cap) != 0 ||
+        read_games(f, n_longest, r->longest, &r->n_longest, spec.k,
+                   BY_LONG, spec.seed, &buf, &cap) != 0 ||
+        read_games(f, n_sample, r->sample, &r->n_sample, spec.m,
+                   BY_KEY, spec.seed, &buf, &cap) != 0) {
+        free(buf);
+        retain_free(r);
+        return NULL;
+    }
+    free(buf);
+    return r;
+}
+
+/*
+ * by_short / by_long / by_index:
+ *   qsort comparators over Sample pointers, best first.
+ */
+static int compare(Order o, const void *a, const void *b) {
+    const Sample *x = *(const Sample *const *)a;
+    const Sample *y = *(const Sample *const *)b;
+    return worse(o, x, y) - worse(o, y, x);
+}
+
+static int by_short(const void *a, const void *b) {
+    return compare(BY_SHORT, a, b);
+}
+
+static int by_long(const void *a, const void *b) {
+    return compare(BY_LONG, a, b);
+}
+
+static int by_index(const void *a, const void *b) {
+    return compare(BY_INDEX, a, b);
+}
+
+/*
+ * print_games:
+ *   Print a heap's games sorted by `cmp` (through an array of pointers;
+ *   the heap itself is not reordered).
+ *   Returns 0 on success, -1 on allocation failure.
+ */
+static int print_games(FILE *out, const char *title, const Sample *h,
+                       size_t n, int (*cmp)(const void *, const void *))
+{
+    if (n == 0) return 0;
+    const Sample **v = malloc(n * sizeof(*v));
+    if (!v) return -1;
+    for (size_t i = 0; i < n; ++i)
+        v[i] = &h[i];
+    qsort(v, n, sizeof(*v), cmp);
+
+    fprintf(out, "\n%s:\n", title);
+    for (size_t i = 0; i < n; ++i) {
+        if (v[i]->rolls == 0) {
+            fprintf(out, "  game %zu: not won, ended on square %zu\n",
+                    v[i]->index, v[i]->end);
+            continue;
+        }
+        fprintf(out, "  game %zu (%zu rolls):", v[i]->index, v[i]->rolls);
+        for (size_t j = 0; j < v[i]->rolls; ++j)
+            fprintf(out, " %zu", v[i]->seq[j]);
+        fprintf(out, "\n");
+    }
+    free(v);
+    return 0;
+}
+
+/*
+ * retain_fprint:
+ *   One section per non-empty heap, each headed by its size.
+ */
+int retain_fprint(FILE *out, const Retain *r) {
+    char title[64];
+    snprintf(title, sizeof(title), "Shortest %zu games", r->n_shortest);
+    if (print_games(out, title, r->shortest, r->n_shortest, by_short) != 0)
+        return -1;
+    snprintf(title, sizeof(title), "Longest %zu games", r->n_longest);
+    if (print_games(out, title, r->longest, r->n_longest, by_long) != 0)
+        return -1;
+    snprintf(title, sizeof(title), "Random sample of %zu games",
+             r->n_sample);
+    return print_games(out, title, r->sample, r->n_sample, by_index);
+}
+
+/*
+ * retain_free:
+ *   Only the first n slots of a heap can own a sequence.
+ */
+void retain_free(Retain *r) {
+    if (!r) return;
+    for (size_t i = 0; i < r->n_shortest; ++i) free(r->shortest[i].seq);
+    for (size_t i = 0; i < r->n_longest; ++i)  free(r->longest[i].seq);
+    for (size_t i = 0; i < r->n_sample; ++i)   free(r->sample[i].seq);
+    free(r->shortest);
+    free(r->longest);
+    free(r->sample);
+    free(r);
+}
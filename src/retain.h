@@ -0,0 +1,113 @@
+#ifndef RETAIN_H
+#define RETAIN_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+/*
+ * RetainSpec:
+ *   Which example games an accumulator keeps besides its counters.
+ *   - k: the k shortest and the k longest winning games.
+ *   - m: a uniform random sample of m games (won or not).
+ *   - seed: the run's seed, which picks the sample (see retain_add).
+ *   k = m = 0 keeps nothing.
+ */
+typedef struct {
+    size_t   k;
+    size_t   m;
+    uint64_t seed;
+} RetainSpec;
+
+/*
+ * Sample:
+ *   One retained game.
+ *   - index: global game index.
+ *   - rolls: rolls taken to win, or 0 if the game was aborted.
+ *   - end:   square the game ended on.
+ *   - key:   reservoir priority, a hash of seed and index (see retain_add).
+ *   - seq:   the faces rolled (rolls entries, buffer of cap entries).
+ */
+typedef struct {
+    size_t   index;
+    size_t   rolls;
+    size_t   end;
+    uint64_t key;
+    size_t  *seq;
+    size_t   cap;
+} Sample;
+
+/*
+ * Retain:
+ *   Bounded example storage. Each array is a binary heap whose root is
+ *   the game that would be dropped first, so offering a game costs
+ *   O(log size) plus a copy of its faces only when it is kept.
+ *   - shortest: up to k wins, root = longest of them.
+ *   - longest:  up to k wins, root = shortest of them.
+ *   - sample:   up to m games, root = largest key.
+ *   Ties in length go to the lower game index, like Stats' shortest game.
+ *   Memory is bounded by (2k + m) * max_steps faces.
+ */
+typedef struct {
+    RetainSpec spec;
+    Sample    *shortest;
+    size_t     n_shortest;
+    Sample    *longest;
+    size_t     n_longest;
+    Sample    *sample;
+    size_t     n_sample;
+} Retain;
+
+/*
+ * retain_create:
+ *   Allocate empty heaps for `spec`.
+ *   Returns NULL on allocation failure.
+ */
+Retain *retain_create(RetainSpec spec);
+
+/*
+ * retain_add:
+ *   Offer one finished game (same arguments as stats_add_game).
+ *   - Wins compete for the shortest and longest heaps.
+ *   - Every game competes for the sample with the key hash(seed, index):
+ *     the m games with the smallest keys form a uniform sample, and since
+ *     the key does not depend on the order games arrive in, the sample of
+ *     a run is the same however it is split across threads or shards.
+ *     Runs with another seed sample other games.
+ *   Returns 0 on success, -1 on allocation failure.
+ */
+int retain_add(Retain *r, size_t index, const size_t *seq, size_t rolls,
+               size_t end);
+
+/*
+ * retain_merge:
+ *   Offer every game retained in src to dst (src is left untouched). The
+ *   result equals adding both game sets to a single Retain.
+ *   Returns 0 on success, -1 on allocation failure.
+ */
+int retain_merge(Retain *dst, const Retain *src);
+
+/*
+ * retain_write / retain_read:
+ *   Serialize as text lines (part of the Stats checkpoint format).
+ *   retain_read returns a new Retain, or NULL on a malformed stream or
+ *   allocation failure.
+ */
+int retain_write(FILE *f, const Retain *r);
+Retain *retain_read(FILE *f);
+
+/*
+ * retain_fprint:
+ *   Print the retained games to `out`: shortest and longest in order of
+ *   length, the sample in game order.
+ *   Returns 0 on success, -1 on allocation failure.
+ */
+int retain_fprint(FILE *out, const Retain *r);
+
+/*
+ * retain_free:
+ *   Free a Retain and every sequence it holds. Safe to call with NULL.
+ */
+void retain_free(Retain *r);
+
+#endif /* RETAIN_H */
@@ -0,0 +1,27 @@
+#include "rng.h"
+
+/*
+ * splitmix64:
+ *   Advance a 64-bit counter and return a well-mixed value from it.
+ *   Used only to expand a seed into a full xoshiro state.
+ */
+static uint64_t splitmix64(uint64_t *x) {
+    uint64_t z = (*x += 0x9e3779b97f4a7c15ULL);
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+    return z ^ (z >> 31);
+}
+
+/*
+ * rng_seed:
+ *   Derive an independent stream from (seed, stream).
+ *   - The seed is mixed first, then the stream number is folded in and mixed
+ *     again, so neighbouring seeds and neighbouring streams do not overlap.
+ *   - Fills all four state words with splitmix64 output (never all zero).
+ */
+void rng_seed(Rng *r, uint64_t seed, uint64_t stream) {
+    uint64_t x = seed;
+    x = splitmix64(&x) ^ stream;
+    for (int i = 0; i < 4; ++i)
+        r->s[i] = splitmix64(&x);
+}
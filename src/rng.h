@@ -0,0 +1,72 @@
+#ifndef RNG_H
+#define RNG_H
+
+#include <stdint.h>
+
+/*
+ * Rng:
+ *   Small, fast pseudo-random number generator (xoshiro256**).
+ *   - s: 256 bits of generator state; never all zero once seeded.
+ *   The whole state is plain data, so it can be copied, stored in a
+ *   checkpoint and restored later to continue the exact same stream.
+ */
+typedef struct {
+    uint64_t s[4];
+} Rng;
+
+/*
+ * rng_seed:
+ *   Initialize a generator for one independent stream.
+ *   - seed:   user-visible seed (e.g. the -S option).
+ *   - stream: stream number; the simulator uses the game index, so game i
+ *             always sees the same rolls no matter how the run is split
+ *             into shards or threads.
+ *   The state is expanded from (seed, stream) with splitmix64.
+ */
+void rng_seed(Rng *r, uint64_t seed, uint64_t stream);
+
+/*
+ * rng_next:
+ *   Return the next 64 random bits and advance the state.
+ */
+static inline uint64_t rng_next(Rng *r) {
+    uint64_t *s = r->s;
+    uint64_t x = s[1] * 5;
+    uint64_t result = ((x << 7) | (x >> 57)) * 9;
+    uint64_t t = s[1] << 17;
+    s[2] ^= s[0];
+    s[3] ^= s[1];
+    s[1] ^= s[2];
+    s[0] ^= s[3];
+    s[2] ^= t;
+    s[3] = (s[3] << 45) | (s[3] >> 19);
+    return result;
+}
+
+/*
+ * rng_below:
+ *   Return a uniform integer in [0 .. n-1] without modulo bias
+ *   (multiply-shift with rejection). n must be non-zero.
+ */
+static inline uint32_t rng_below(Rng *r, uint32_t n) {
+    uint64_t m = (rng_next(r) >> 32) * n;
+    uint32_t lo = (uint32_t)m;
+    if (lo < n) {
+        uint32_t threshold = (uint32_t)-n % n;
+        while (lo < threshold) {
+            m  = (rng_next(r) >> 32) * n;
+            lo = (uint32_t)m;
+        }
+    }
+    return (uint32_t)(m >> 32);
+}
+
+/*
+ * rng_double:
+ *   Return a uniform double in [0, 1) with 53 bits of precision.
+ */
+static inline double rng_double(Rng *r) {
+    return (double)(rng_next(r) >> 11) * 0x1.0p-53;
+}
+
+#endif /* RNG_H */
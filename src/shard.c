@@ -0,0 +1,297 @@
+#include "shard.h"
+#include "hash.h"
+
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define SHARD_MAGIC   "pfusch-shard"
+#define SHARD_VERSION 6
+
+/*
+ * shard_fingerprint:
+ *   Hash the board size, every adjacency entry, the die's sides and prefix
+ *   sums, the kernel (and its roll count) and max_steps. Two runs with
+ *   equal fingerprints play identical games for identical (seed, index)
+ *   pairs.
+ */
+uint64_t shard_fingerprint(const SimPlan *plan, size_t max_steps) {
+    const Board *b = plan->b;
+    const Die   *d = plan->d;
+    uint64_t h = FNV1A_INIT;
+    h = fnv1a(h, &b->size, sizeof b->size);
+    for (size_t i = 0; i < b->size; ++i)
+        h = fnv1a(h, b->adj[i], b->adj_cnt[i] * sizeof(size_t));
+    h = fnv1a(h, &d->sides, sizeof d->sides);
+    if (d->probs)
+        h = fnv1a(h, d->probs, d->sides * sizeof(double));
+    uint32_t kernel = (uint32_t)plan->kernel;
+    h = fnv1a(h, &kernel, sizeof kernel);
+    h = fnv1a(h, &plan->multi_k, sizeof plan->multi_k);
+    h = fnv1a(h, &max_steps, sizeof max_steps);
+    return h;
+}
+
+/*
+ * shard_create:
+ *   Validate index < count, compute the shard's game range and allocate an
+ *   empty Stats accumulator for it.
+ */
+Shard *shard_create(const Board *b, uint64_t seed, size_t iterations,
+                    size_t max_steps, uint64_t fingerprint,
+                    size_t index, size_t count, RetainSpec keep)
+{
+    if (count == 0 || index >= count)
+        return NULL;
+
+    Shard *s = calloc(1, sizeof(Shard));
+    if (!s) return NULL;
+    s->seed        = seed;
+    s->iterations  = iterations;
+    s->max_steps   = max_steps;
+    s->fingerprint = fingerprint;
+    s->index       = index;
+    s->count       = count;
+    s->first       = iterations / count * index
+                   + iterations % count * index / count;
+    s->last        = iterations / count * (index + 1)
+                   + iterations % count * (index + 1) / count;
+    s->next        = s->first;
+    s->st          = stats_create(b, keep);
+    if (!s->st) {
+        free(s);
+        return NULL;
+    }
+    return s;
+}
+
+/*
+ * shard_run:
+ *   Play the remaining games of the shard one by one, each with its own
+ *   RNG stream, folding them into the accumulator (and the trace, if any)
+ *   as soon as each game ends. Checkpoints are taken between games, so a
+ *   resumed shard continues exactly where it stopped.
+ */
+int shard_run(Shard *s, const SimPlan *plan,
+              const char *ckpt_path, size_t every, TraceWriter *trace)
+{
+    const Board *b = plan->b;
+    size_t *buffer = malloc((s->max_steps ? s->max_steps : 1) * sizeof(size_t));
+    if (!buffer) return -1;
+
+    size_t since_ckpt = 0;
+    while (s->next < s->last) {
+        Rng rng;
+        rng_seed(&rng, s->seed, s->next);
+        size_t end;
+        size_t r = sim_plan_play(plan, &rng, buffer, s->max_steps, &end);
+        if (stats_add_game(s->st, b, s->next, buffer, r, end) != 0 ||
+            (trace && trace_write_game(trace, buffer, r, end) != 0)) {
+            free(buffer);
+            return -1;
+        }
+        s->next++;
+
+        if (ckpt_path && every && ++since_ckpt == every && s->next < s->last) {
+            since_ckpt = 0;
+            if (shard_save(s, b, ckpt_path) != 0) {
+                free(buffer);
+                return -1;
+            }
+        }
+    }
+    free(buffer);
+
+    if (ckpt_path && shard_save(s, b, ckpt_path) != 0)
+        return -1;
+    return 0;
+}
+
+/*
+ * shard_save:
+ *   Checkpoint layout (one keyword per line, then the Stats lines):
+ *     pfusch-shard 6
+ *     seed <seed>
+ *     iterations <n>
+ *     max_steps <n>
+ *     fingerprint <hex>
+ *     shard <index> <count>
+ *     range <first> <last>
+ *     next <next>
+ *     games / shortest / jumps / stuck / occupancy ...
+ *                                              (see stats_write)
+ *     retain <k> <m> <seed> <n_shortest> <n_longest> <n_sample>
+ *     game <index> <rolls> <end> <faces...>    (see retain_write)
+ */
+int shard_save(const Shard *s, const Board *b, const char *path) {
+    size_t len = strlen(path);
+    char *tmp = malloc(len + sizeof ".tmp");
+    if (!tmp) return -1;
+    memcpy(tmp, path, len);
+    memcpy(tmp + len, ".tmp", sizeof ".tmp");
+
+    FILE *f = fopen(tmp, "w");
+    if (!f) {
+        fprintf(stderr, "Error: cannot write checkpoint '%s'\n", tmp);
+        free(tmp);
+        return -1;
+    }
+    fprintf(f, "%s %d\n", SHARD_MAGIC, SHARD_VERSION);
+    fprintf(f, "seed %" PRIu64 "\n", s->seed);
+    fprintf(f, "iterations %zu\n", s->iterations);
+    fprintf(f, "max_steps %zu\n", s->max_steps);
+    fprintf(f, "fingerprint %016" PRIx64 "\n", s->fingerprint);
+    fprintf(f, "shard %zu %zu\n", s->index, s->count);
+    fprintf(f, "range %zu %zu\n", s->first, s->last);
+    fprintf(f, "next %zu\n", s->next);
+    int err = stats_write(f, s->st, b);
+    if (fclose(f) != 0 || err) {
+        fprintf(stderr, "Error: failed writing checkpoint '%s'\n", tmp);
+        remove(tmp);
+        free(tmp);
+        return -1;
+    }
+    if (rename(tmp, path) != 0) {
+        fprintf(stderr, "Error: cannot replace checkpoint '%s'\n", path);
+        remove(tmp);
+        free(tmp);
+        return -1;
+    }
+    free(tmp);
+    return 0;
+}
+
+/*
+ * shard_load:
+ *   Parse a checkpoint and sanity-check its ranges
+ *   (first <= next <= last <= iterations, index < count).
+ */
+Shard *shard_load(const Board *b, const char *path) {
+    FILE *f = fopen(path, "r");
+    if (!f) return NULL;
+
+    Shard *s = calloc(1, sizeof(Shard));
+    if (!s) {
+        fclose(f);
+        return NULL;
+    }
+
+    char magic[32];
+    int version;
+    int ok =
+        fscanf(f, "%31s %d", magic, &version) == 2 &&
+        strcmp(magic, SHARD_MAGIC) == 0 && version == SHARD_VERSION &&
+        fscanf(f, " seed %" SCNu64, &s->seed) == 1 &&
+        fscanf(f, " iterations %zu", &s->iterations) == 1 &&
+        fscanf(f, " max_steps %zu", &s->max_steps) == 1 &&
+        fscanf(f, " fingerprint %" SCNx64, &s->fingerprint) == 1 &&
+        fscanf(f, " shard %zu %zu", &s->index, &s->count) == 2 &&
+        fscanf(f, " range %zu %zu", &s->first, &s->last) == 2 &&
+        fscanf(f, " next %zu", &s->next) == 1;
+    if (ok)
+        s->st = stats_read(f, b);
+    fclose(f);
+
+    if (!ok || !s->st ||
+        s->index >= s->count ||
+        s->first > s->next || s->next > s->last ||
+        s->last > s->iterations) {
+        shard_free(s);
+        return NULL;
+    }
+    return s;
+}
+
+/*
+ * cmp_shard_first:
+ *   qsort comparator ordering shards by the first game they cover.
+ */
+static int cmp_shard_first(const void *a, const void *b) {
+    const Shard *x = *(Shard * const *)a;
+    const Shard *y = *(Shard * const *)b;
+    return (x->first > y->first) - (x->first < y->first);
+}
+
+/*
+ * shard_merge:
+ *   Load every file, sort by range, verify compatibility and coverage,
+ *   then fold each shard's statistics into one accumulator.
+ */
+Stats *shard_merge(const Board *b, uint64_t fingerprint,
+                   char **paths, size_t n_paths)
+{
+    if (n_paths == 0) return NULL;
+
+    Shard **shards = calloc(n_paths, sizeof(Shard *));
+    if (!shards) return NULL;
+
+    Stats *out = NULL;
+    for (size_t i = 0; i < n_paths; ++i) {
+        shards[i] = shard_load(b, paths[i]);
+        if (!shards[i]) {
+            fprintf(stderr, "Error: cannot read shard '%s'\n", paths[i]);
+            goto done;
+        }
+        if (shards[i]->fingerprint != fingerprint) {
+            fprintf(stderr,
+                    "Error: shard '%s' was run with a different board, "
+                    "die or step limit\n", paths[i]);
+            goto done;
+        }
+        if (shards[i]->next != shards[i]->last) {
+            fprintf(stderr, "Error: shard '%s' is unfinished (%zu/%zu games)\n",
+                    paths[i], shards[i]->next - shards[i]->first,
+                    shards[i]->last - shards[i]->first);
+            goto done;
+        }
+    }
+    qsort(shards, n_paths, sizeof(Shard *), cmp_shard_first);
+
+    size_t expect = 0;
+    for (size_t i = 0; i < n_paths; ++i) {
+        if (shards[i]->seed != shards[0]->seed ||
+            shards[i]->iterations != shards[0]->iterations) {
+            fprintf(stderr, "Error: shards come from different runs "
+                            "(seed or iteration count differ)\n");
+            goto done;
+        }
+        if (shards[i]->first != expect) {
+            fprintf(stderr, "Error: shards %s games starting at %zu\n",
+                    shards[i]->first > expect ? "are missing" : "overlap on",
+                    expect);
+            goto done;
+        }
+        expect = shards[i]->last;
+    }
+    if (expect != shards[0]->iterations) {
+        fprintf(stderr, "Error: shards are missing games %zu..%zu\n",
+                expect, shards[0]->iterations - 1);
+        goto done;
+    }
+
+    /* stats_merge adopts the shards' retention policy */
+    out = stats_create(b, (RetainSpec){ 0, 0, 0 });
+    for (size_t i = 0; out && i < n_paths; ++i) {
+        if (stats_merge(out, shards[i]->st, b) != 0) {
+            stats_free(out);
+            out = NULL;
+        }
+    }
+
+done:
+    for (size_t i = 0; i < n_paths; ++i)
+        shard_free(shards[i]);
+    free(shards);
+    return out;
+}
+
+/*
+ * shard_free:
+ *   Release a Shard and its Stats; NULL is ignored.
+ */
+void shard_free(Shard *s) {
+    if (!s) return;
+    stats_free(s->st);
+    free(s);
+}
@@ -0,0 +1,102 @@
+#ifndef SHARD_H
+#define SHARD_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "board.h"
+#include "die.h"
+#include "sim.h"
+#include "stats.h"
+#include "trace.h"
+
+/*
+ * Shard:
+ *   A reproducible slice of a run plus its accumulated statistics.
+ *   Game i always rolls from RNG stream (seed, i), so the per-game RNG
+ *   state is fully described by the next game index; a checkpoint needs no
+ *   generator words of its own.
+ *   - seed, iterations, max_steps: parameters of the whole run.
+ *   - fingerprint: hash of the built graph, die weights and max_steps;
+ *                  shards are only merged/resumed when fingerprints match.
+ *   - index, count: this is shard `index` of `count` (0-based).
+ *   - first, last:  game range [first, last) covered by this shard.
+ *   - next:         next game index to simulate (== last when finished).
+ *   - st:           statistics of games [first, next).
+ */
+typedef struct {
+    uint64_t seed;
+    size_t   iterations;
+    size_t   max_steps;
+    uint64_t fingerprint;
+    size_t   index, count;
+    size_t   first, last;
+    size_t   next;
+    Stats   *st;
+} Shard;
+
+/*
+ * shard_fingerprint:
+ *   Hash everything that must agree between shards of one run: the built
+ *   adjacency table (board, die size and win rule), the die weights, the
+ *   simulation kernel (kernels draw from the RNG differently) and
+ *   max_steps.
+ */
+uint64_t shard_fingerprint(const SimPlan *plan, size_t max_steps);
+
+/*
+ * shard_create:
+ *   Create an empty shard `index` of `count` for a run of `iterations`
+ *   games. Shard k covers games [iterations*k/count, iterations*(k+1)/count).
+ *   Its statistics retain the example games described by `keep`; the
+ *   policy is saved with the checkpoint and kept on resume.
+ *   Returns NULL on invalid arguments or allocation failure.
+ */
+Shard *shard_create(const Board *b, uint64_t seed, size_t iterations,
+                    size_t max_steps, uint64_t fingerprint,
+                    size_t index, size_t count, RetainSpec keep);
+
+/*
+ * shard_run:
+ *   Simulate games [next, last) with `plan` and accumulate them into s->st.
+ *   - ckpt_path: if non-NULL, the shard is saved there every `every` games
+ *                (0 = only at the end) and once more when it finishes.
+ *   - trace:     if non-NULL, every game is also streamed to this writer.
+ *   Returns 0 on success, -1 on allocation, checkpoint or trace write failure.
+ */
+int shard_run(Shard *s, const SimPlan *plan,
+              const char *ckpt_path, size_t every, TraceWriter *trace);
+
+/*
+ * shard_save:
+ *   Write the shard to `path` as a text checkpoint. The file is written
+ *   to "<path>.tmp" first and renamed, so a crash never leaves a
+ *   half-written checkpoint behind. Returns 0 on success, -1 on error.
+ */
+int shard_save(const Shard *s, const Board *b, const char *path);
+
+/*
+ * shard_load:
+ *   Read a checkpoint written by shard_save.
+ *   Returns a new Shard, or NULL on I/O error or malformed file.
+ */
+Shard *shard_load(const Board *b, const char *path);
+
+/*
+ * shard_merge:
+ *   Load finished shard files and combine them into the statistics a
+ *   single run over all iterations would have produced.
+ *   - All shards must share seed, iterations and fingerprint, be finished,
+ *     and together cover [0, iterations) without gaps or overlap.
+ *   Prints a diagnostic to stderr and returns NULL on any mismatch.
+ */
+Stats *shard_merge(const Board *b, uint64_t fingerprint,
+                   char **paths, size_t n_paths);
+
+/*
+ * shard_free:
+ *   Free a Shard and its statistics. Safe to call with a NULL pointer.
+ */
+void shard_free(Shard *s);
+
+#endif /* SHARD_H */
@@ -1,5 +1,8 @@
 #include "sim.h"
+#include "bitpack.h"
 
+#include <math.h>
+#include <stdint.h>
 #include <stdlib.h>
 #include <string.h>
 
@@ -8,66 +11,609 @@
  *   Play a single game on board b using die d.
  *   - b: pointer to an initialized Board with adjacency graph built.
  *   - d: pointer to a Die used for rolling.
+ *   - rng: generator the die draws from.
  *   - out_sequence: caller-allocated array of length max_steps to record each die face rolled.
  *   - max_steps: maximum number of rolls allowed before aborting.
+ *   - out_end: optional; receives the square the game ended on.
  *   Returns the number of rolls taken to reach the last square (b->size - 1),
- *   or 0 if the game did not finish within max_steps.
+ *   or 0 if the game did not finish within max_steps. A game that lands on a
+ *   dead square (b->dead) can never win, so it is abandoned immediately
+ *   instead of burning the remaining steps.
  *   The faces rolled on each step (1..sides) are written into out_sequence[0..rolls-1].
  */
 size_t simulate_one(const Board *b,
                     const Die *d,
+                    Rng *rng,
                     size_t *out_sequence,
-                    size_t max_steps)
+                    size_t max_steps,
+                    size_t *out_end)
 {
     size_t pos = 0;
-    for (size_t roll = 1; roll <= max_steps; ++roll) {
-        size_t face = die_roll((Die*)d);
-        out_sequence[roll-1] = face;
+    size_t rolls = 0;  /* stays 0 unless the goal is reached */
+    if (!b->dead[pos]) {
+        for (size_t roll = 1; roll <= max_steps; ++roll) {
+            size_t face = die_roll(d, rng);
+            out_sequence[roll-1] = face;
 
-        size_t next = b->adj[pos][face-1];
-        pos = next;
+            size_t next = b->adj[pos][face-1];
+            pos = next;
 
-        if (pos == b->size - 1)
-            return roll;
+            if (pos == b->size - 1) {
+                rolls = roll;
+                break;
+            }
+            if (b->dead[pos])
+                break;     /* stuck: the goal is unreachable from here */
+        }
+    }
+    if (out_end)
+        *out_end = pos;
+    return rolls;  /* 0: did not reach the end within max_steps */
+}
+
+/*
+ * faces_alloc:
+ *   Allocate the tables of a SimFaces for n squares and `sides` faces.
+ *   Returns 0 on success, -1 on allocation failure (free with faces_free).
+ */
+static int faces_alloc(SimFaces *t, size_t n, size_t sides) {
+    t->count  = calloc(n, sizeof(uint32_t));
+    t->face   = calloc(n * sides, sizeof(uint32_t));
+    t->alias  = calloc(n * sides, sizeof(uint32_t));
+    t->accept = calloc(n * sides, sizeof(double));
+    return t->count && t->face && t->alias && t->accept ? 0 : -1;
+}
+
+/*
+ * faces_free:
+ *   Free the tables of a SimFaces (the struct itself is not owned).
+ */
+static void faces_free(SimFaces *t) {
+    free(t->count);
+    free(t->face);
+    free(t->alias);
+    free(t->accept);
+}
+
+/*
+ * fill_faces:
+ *   Build square i's alias table in t over the faces selected by `stay`
+ *   (adj[i][f] == i when stay is non-zero, != i otherwise) that have
+ *   positive probability. `w` is scratch space for `sides` weights.
+ *   Returns 0 on success, -1 on allocation failure.
+ */
+static int fill_faces(SimFaces *t, const Board *b, const Die *d,
+                      size_t i, int stay, double *w)
+{
+    size_t sides = d->sides, base = i * d->sides;
+    uint32_t n = 0;
+    for (size_t f = 1; f <= sides; ++f) {
+        double pf = die_face_prob(d, f);
+        if ((b->adj[i][f-1] == i) == (stay != 0) && pf > 0.0) {
+            t->face[base + n] = (uint32_t)f;
+            w[n++] = pf;
+        }
+    }
+    t->count[i] = n;
+    if (!d->probs) {
+        /* fair die: every selected face is equally likely */
+        for (uint32_t c = 0; c < n; ++c) {
+            t->accept[base + c] = 1.0;
+            t->alias[base + c]  = c;
+        }
+        return 0;
+    }
+    return n ? die_alias_build(w, n, t->accept + base, t->alias + base)
+             : 0;
+}
+
+/*
+ * draw_face:
+ *   Draw a face from square pos's alias table in t: one bounded integer,
+ *   plus one uniform double only for columns that share their mass.
+ */
+static inline size_t draw_face(const SimFaces *t, size_t pos, size_t sides,
+                               Rng *rng)
+{
+    size_t   base = pos * sides;
+    uint32_t c    = rng_below(rng, t->count[pos]);
+    double   a    = t->accept[base + c];
+    if (a < 1.0 && rng_double(rng) >= a)
+        c = t->alias[base + c];
+    return t->face[base + c];
+}
+
+/*
+ * play_generic:
+ *   GENERIC kernel: adapt simulate_one to the SimPlayFn signature.
+ */
+static size_t play_generic(const SimPlan *p, Rng *rng,
+                           size_t *out_sequence, size_t max_steps,
+                           size_t *out_end)
+{
+    return simulate_one(p->b, p->d, rng, out_sequence, max_steps, out_end);
+}
+
+/*
+ * DEFINE_FAIR_KERNEL:
+ *   Expand to a FAIR kernel for a fair die with SIDES faces under the win
+ *   rule EXCEED (1 = clamp overshoots to the goal, 0 = stay in place).
+ *   Both are compile-time constants, so rng_below's rejection threshold
+ *   folds to a constant, the rule test disappears, and the move is
+ *   computed as mapping[pos + face] (one load) rather than through the
+ *   adjacency row pointer (two dependent loads). The result matches
+ *   board_build_graph entry for entry.
+ */
+#define DEFINE_FAIR_KERNEL(NAME, SIDES, EXCEED)                          \
+static size_t NAME(const SimPlan *p, Rng *rng,                           \
+                   size_t *out_sequence, size_t max_steps,               \
+                   size_t *out_end)                                      \
+{                                                                        \
+    const size_t *mapping    = p->b->mapping;                            \
+    const unsigned char *dead = p->b->dead;                              \
+    size_t goal  = p->b->size - 1;                                       \
+    size_t pos   = 0;                                                    \
+    size_t rolls = 0;                                                    \
+    for (size_t done = 0; !dead[pos] && done < max_steps; ) {            \
+        size_t face = (size_t)rng_below(rng, (SIDES)) + 1;               \
+        size_t raw  = pos + face;                                        \
+        out_sequence[done++] = face;                                     \
+        if (raw > goal)                                                  \
+            pos = mapping[(EXCEED) ? goal : pos];                        \
+        else                                                             \
+            pos = mapping[raw];                                          \
+        if (pos == goal) {                                               \
+            rolls = done;                                                \
+            break;                                                       \
+        }                                                                \
+    }                                                                    \
+    if (out_end)                                                         \
+        *out_end = pos;                                                  \
+    return rolls;                                                        \
+}
+
+DEFINE_FAIR_KERNEL(play_fair_d4_exceed,   4, 1)
+DEFINE_FAIR_KERNEL(play_fair_d4_exact,    4, 0)
+DEFINE_FAIR_KERNEL(play_fair_d6_exceed,   6, 1)
+DEFINE_FAIR_KERNEL(play_fair_d6_exact,    6, 0)
+DEFINE_FAIR_KERNEL(play_fair_d8_exceed,   8, 1)
+DEFINE_FAIR_KERNEL(play_fair_d8_exact,    8, 0)
+DEFINE_FAIR_KERNEL(play_fair_d12_exceed, 12, 1)
+DEFINE_FAIR_KERNEL(play_fair_d12_exact,  12, 0)
+DEFINE_FAIR_KERNEL(play_fair_d20_exceed, 20, 1)
+DEFINE_FAIR_KERNEL(play_fair_d20_exact,  20, 0)
+
+/* Specialized FAIR kernels, looked up by (sides, win rule) */
+static const struct {
+    size_t    sides;
+    int       win_by_exceed;
+    SimPlayFn play;
+} fair_kernels[] = {
+    {  4, 1, play_fair_d4_exceed  }, {  4, 0, play_fair_d4_exact  },
+    {  6, 1, play_fair_d6_exceed  }, {  6, 0, play_fair_d6_exact  },
+    {  8, 1, play_fair_d8_exceed  }, {  8, 0, play_fair_d8_exact  },
+    { 12, 1, play_fair_d12_exceed }, { 12, 0, play_fair_d12_exact },
+    { 20, 1, play_fair_d20_exceed }, { 20, 0, play_fair_d20_exact },
+};
+
+/*
+ * find_fair_kernel:
+ *   Return the specialized kernel for a fair die of this size under the
+ *   board's win rule, or NULL if none was compiled.
+ */
+static SimPlayFn find_fair_kernel(const Board *b, const Die *d) {
+    if (d->probs)
+        return NULL;
+    for (size_t i = 0; i < sizeof fair_kernels / sizeof *fair_kernels; ++i)
+        if (fair_kernels[i].sides == d->sides &&
+            fair_kernels[i].win_by_exceed == (b->win_by_exceed != 0))
+            return fair_kernels[i].play;
+    return NULL;
+}
+
+/*
+ * choose_multi:
+ *   Decide whether the MULTI kernel applies and pick k.
+ *   - Requires a fair die and squares that fit into 24 bits.
+ *   - Picks the largest k <= SIM_MULTI_MAX_ROLLS (at least 2) whose table
+ *     fits in SIM_MULTI_CACHE_BYTES; when forced, k = 2 is accepted even
+ *     if the table is larger, as long as sides^2 fits in 32 bits.
+ *   Sets p->multi_k/multi_span and returns 1 if MULTI can be used.
+ */
+static int choose_multi(SimPlan *p, int forced) {
+    size_t sides = p->d->sides, n = p->b->size;
+    if (p->d->probs || sides < 2 || n > (1u << 24))
+        return 0;
+
+    size_t best = 0;
+    uint64_t span = sides, best_span = 0;
+    for (size_t k = 2; k <= SIM_MULTI_MAX_ROLLS; ++k) {
+        span *= sides;
+        if (span > UINT32_MAX)
+            break;
+        if (n * span * sizeof(uint32_t) <= SIM_MULTI_CACHE_BYTES ||
+            (forced && k == 2)) {
+            best      = k;
+            best_span = span;
+        }
+    }
+    if (!best)
+        return 0;
+    p->multi_k    = best;
+    p->multi_span = (uint32_t)best_span;
+    return 1;
+}
+
+/*
+ * multi_beats_fair:
+ *   Whether the k-roll table chosen by choose_multi is expected to be
+ *   faster than a FAIR kernel: always for k >= 3, for k = 2 only on boards
+ *   of at most SIM_MULTI_FAIR_SQUARES squares.
+ */
+static int multi_beats_fair(const SimPlan *p) {
+    return p->multi_k >= 3 || p->b->size <= SIM_MULTI_FAIR_SQUARES;
+}
+
+/*
+ * build_multi:
+ *   Fill p->multi by playing every combination of k faces from every
+ *   square through b->adj, stopping at the goal or a dead square exactly
+ *   as the single-roll kernel would.
+ *   Returns 0 on success, -1 on allocation failure.
+ */
+static int build_multi(SimPlan *p) {
+    const Board *b = p->b;
+    size_t sides = p->d->sides, goal = b->size - 1;
+    p->multi = malloc(b->size * p->multi_span * sizeof(uint32_t));
+    if (!p->multi) return -1;
+
+    for (size_t i = 0; i < b->size; ++i) {
+        uint32_t *row = p->multi + i * p->multi_span;
+        for (uint32_t c = 0; c < p->multi_span; ++c) {
+            size_t pos = i, stop = 0;
+            uint32_t digits = c;
+            for (size_t j = 1; j <= p->multi_k; ++j) {
+                pos = b->adj[pos][digits % sides];
+                digits /= (uint32_t)sides;
+                if (pos == goal || b->dead[pos]) {
+                    stop = j;
+                    break;
+                }
+            }
+            row[c] = (uint32_t)pos | (uint32_t)stop << 24;
+        }
+    }
+    return 0;
+}
+
+/*
+ * play_skip:
+ *   SKIP kernel. On a square with stay probability s > 0 the number of
+ *   rolls K spent in place before the next real move is geometric,
+ *   P(K = k) = s^k (1 - s), and is drawn at once as floor(log(U) / log(s)).
+ *   The skipped rolls still count toward the roll total and max_steps, and
+ *   their faces are drawn from the square's stay alias table (O(1) each)
+ *   so the recorded sequence is distributed exactly like one from
+ *   simulate_one. The move itself is drawn from the faces that leave the
+ *   square.
+ */
+static size_t play_skip(const SimPlan *p, Rng *rng,
+                        size_t *out_sequence, size_t max_steps,
+                        size_t *out_end)
+{
+    const Board *b = p->b;
+    size_t sides = p->d->sides;
+    size_t goal  = b->size - 1;
+    size_t pos   = 0;
+    size_t done  = 0;  /* rolls used so far */
+    size_t rolls = 0;  /* stays 0 unless the goal is reached */
+
+    while (!b->dead[pos] && done < max_steps) {
+        size_t face;
+        if (p->log_stay[pos] < 0.0) {
+            /* U in (0, 1] so log(U) is finite; k may still be huge */
+            double k = floor(log(1.0 - rng_double(rng)) / p->log_stay[pos]);
+            size_t left  = max_steps - done;
+            size_t stays = k < (double)left ? (size_t)k : left;
+            /* local generator: stores to out_sequence cannot alias it */
+            Rng r = *rng;
+            for (size_t j = 0; j < stays; ++j)
+                out_sequence[done++] = draw_face(&p->stay, pos, sides, &r);
+            *rng = r;
+            if (done == max_steps)
+                break;
+            face = draw_face(&p->move, pos, sides, rng);
+        } else {
+            face = die_roll(p->d, rng);
+        }
+        out_sequence[done++] = face;
+        pos = b->adj[pos][face-1];
+
+        if (pos == goal) {
+            rolls = done;
+            break;
+        }
+    }
+    if (out_end)
+        *out_end = pos;
+    return rolls;
+}
+
+/*
+ * play_multi:
+ *   MULTI kernel. One uniform draw in [0, sides^k) stands for k fair rolls;
+ *   the table gives the square after them (or after the roll that ended
+ *   the game) and the faces are recovered from the draw's base-`sides`
+ *   digits. When fewer than k rolls remain before max_steps, the game
+ *   finishes with single rolls so the step limit is honoured exactly.
+ */
+static size_t play_multi(const SimPlan *p, Rng *rng,
+                         size_t *out_sequence, size_t max_steps,
+                         size_t *out_end)
+{
+    const Board *b = p->b;
+    uint32_t sides = (uint32_t)p->d->sides;
+    size_t k     = p->multi_k;
+    size_t goal  = b->size - 1;
+    size_t pos   = 0;
+    size_t done  = 0;
+    size_t rolls = 0;
+
+    while (!b->dead[pos] && max_steps - done >= k) {
+        uint32_t c = rng_below(rng, p->multi_span);
+        uint32_t e = p->multi[pos * p->multi_span + c];
+        size_t used = (e >> 24) ? (e >> 24) : k;
+        for (size_t j = 0; j < used; ++j) {
+            out_sequence[done++] = c % sides + 1;
+            c /= sides;
+        }
+        pos = e & 0xffffffu;
+        if (pos == goal) {
+            rolls = done;
+            break;
+        }
+    }
+    /* tail: fewer than k rolls left */
+    while (!rolls && !b->dead[pos] && done < max_steps) {
+        size_t face = die_roll(p->d, rng);
+        out_sequence[done++] = face;
+        pos = b->adj[pos][face-1];
+        if (pos == goal) {
+            rolls = done;
+            break;
+        }
+    }
+    if (out_end)
+        *out_end = pos;
+    return rolls;
+}
+
+/*
+ * skip_share:
+ *   Fraction of the rolls of a pilot run (SIM_SKIP_PILOT_GAMES games of at
+ *   most SIM_SKIP_PILOT_STEPS rolls, fixed seed so the choice is
+ *   reproducible) that are taken on squares SKIP would skip.
+ */
+static double skip_share(const SimPlan *p) {
+    const Board *b = p->b;
+    size_t rolls = 0, skipped = 0;
+    for (size_t g = 0; g < SIM_SKIP_PILOT_GAMES; ++g) {
+        Rng rng;
+        rng_seed(&rng, 0, g);
+        size_t pos = 0;
+        for (size_t s = 0; s < SIM_SKIP_PILOT_STEPS; ++s) {
+            if (pos == b->size - 1 || b->dead[pos])
+                break;
+            if (p->stay_prob[pos] >= SIM_SKIP_MIN_STAY)
+                skipped++;
+            rolls++;
+            pos = b->adj[pos][die_roll(p->d, &rng) - 1];
+        }
     }
-    return 0;  /* did not reach the end within max_steps */
+    return rolls ? (double)skipped / (double)rolls : 0.0;
+}
+
+/*
+ * sim_plan_create:
+ *   - Always computes stay_prob (needed to choose a kernel); AUTO runs the
+ *     skip_share pilot only if some square reaches SIM_SKIP_MIN_STAY.
+ *   - For SKIP, additionally fills log_stay and the move/stay alias tables
+ *     for every live square with stay_prob >= SIM_SKIP_MIN_STAY from which
+ *     the token can move; log_stay stays 0 elsewhere.
+ *   - For MULTI, builds the k-roll table (see build_multi).
+ */
+SimPlan *sim_plan_create(const Board *b, const Die *d, SimKernel kernel) {
+    SimPlan *p = calloc(1, sizeof(SimPlan));
+    if (!p) return NULL;
+    p->b = b;
+    p->d = d;
+
+    size_t n = b->size, sides = d->sides;
+    p->stay_prob = calloc(n, sizeof(double));
+    if (!p->stay_prob) {
+        sim_plan_free(p);
+        return NULL;
+    }
+    double max_stay = 0.0;
+    for (size_t i = 0; i < n; ++i) {
+        for (size_t f = 1; f <= sides; ++f)
+            if (b->adj[i][f-1] == i)
+                p->stay_prob[i] += die_face_prob(d, f);
+        if (i != n - 1 && !b->dead[i] && p->stay_prob[i] > max_stay)
+            max_stay = p->stay_prob[i];
+    }
+
+    /* dispatcher: resolve the kernel (and its function) once per run */
+    SimPlayFn fair = find_fair_kernel(b, d);
+    if (kernel == SIM_KERNEL_AUTO && max_stay >= SIM_SKIP_MIN_STAY &&
+        skip_share(p) >= SIM_SKIP_MIN_SHARE)
+        kernel = SIM_KERNEL_SKIP;
+    if (kernel == SIM_KERNEL_AUTO || kernel == SIM_KERNEL_MULTI) {
+        int forced = kernel == SIM_KERNEL_MULTI;
+        kernel = fair && !forced ? SIM_KERNEL_FAIR : SIM_KERNEL_GENERIC;
+        if (choose_multi(p, forced) &&
+            (forced || !fair || multi_beats_fair(p))) {
+            if (build_multi(p) != 0) {
+                sim_plan_free(p);
+                return NULL;
+            }
+            kernel = SIM_KERNEL_MULTI;
+        } else {
+            p->multi_k    = 0;
+            p->multi_span = 0;
+        }
+    }
+    if (kernel == SIM_KERNEL_FAIR && !fair)
+        kernel = SIM_KERNEL_GENERIC;
+
+    p->kernel = kernel;
+    switch (kernel) {
+    case SIM_KERNEL_SKIP:  p->play = play_skip;    break;
+    case SIM_KERNEL_MULTI: p->play = play_multi;   break;
+    case SIM_KERNEL_FAIR:  p->play = fair;         break;
+    default:               p->play = play_generic; break;
+    }
+    if (kernel != SIM_KERNEL_SKIP)
+        return p;
+
+    p->log_stay = calloc(n, sizeof(double));
+    double *w   = malloc(sides * sizeof(double));
+    if (!p->log_stay || !w || faces_alloc(&p->move, n, sides) != 0 ||
+        faces_alloc(&p->stay, n, sides) != 0) {
+        free(w);
+        sim_plan_free(p);
+        return NULL;
+    }
+    for (size_t i = 0; i < n; ++i) {
+        if (i == n - 1 || b->dead[i] || p->stay_prob[i] < SIM_SKIP_MIN_STAY)
+            continue;
+        /* sum the moving faces directly: 1 - stay_prob cancels to 0 when
+         * they are rare, and log1p keeps their tiny total exact */
+        double move = 0.0;
+        for (size_t f = 1; f <= sides; ++f)
+            if (b->adj[i][f-1] != i)
+                move += die_face_prob(d, f);
+        double ls = log1p(-move);
+        if (!(move > 0.0) || !isfinite(ls) || !(ls < 0.0))
+            continue;  /* stuck square: play_skip takes the plain roll */
+        p->log_stay[i] = ls;
+        if (fill_faces(&p->move, b, d, i, 0, w) != 0 ||
+            fill_faces(&p->stay, b, d, i, 1, w) != 0) {
+            free(w);
+            sim_plan_free(p);
+            return NULL;
+        }
+    }
+    free(w);
+    return p;
+}
+
+/*
+ * sim_plan_play:
+ *   Call the kernel function resolved when the plan was built.
+ */
+size_t sim_plan_play(const SimPlan *p, Rng *rng,
+                     size_t *out_sequence, size_t max_steps,
+                     size_t *out_end)
+{
+    return p->play(p, rng, out_sequence, max_steps, out_end);
+}
+
+/*
+ * sim_plan_free:
+ *   Free every table of the plan and the plan itself; NULL is ignored.
+ */
+void sim_plan_free(SimPlan *p) {
+    if (!p) return;
+    free(p->stay_prob);
+    free(p->log_stay);
+    faces_free(&p->move);
+    faces_free(&p->stay);
+    free(p->multi);
+    free(p);
+}
+
+/* CLI names, indexed by SimKernel */
+static const char *const kernel_names[] = {
+    "auto", "generic", "skip", "multi", "fair"
+};
+
+/*
+ * sim_kernel_name:
+ *   Return the CLI name of a kernel.
+ */
+const char *sim_kernel_name(SimKernel k) {
+    return kernel_names[k];
+}
+
+/*
+ * sim_kernel_parse:
+ *   Look up a kernel by CLI name; returns 0 and sets *out on success.
+ */
+int sim_kernel_parse(const char *name, SimKernel *out) {
+    for (size_t i = 0; i < sizeof kernel_names / sizeof *kernel_names; ++i) {
+        if (strcmp(name, kernel_names[i]) == 0) {
+            *out = (SimKernel)i;
+            return 0;
+        }
+    }
+    return -1;
 }
 
 /*
  * simulate_many:
  *   Run multiple game simulations and collect results.
- *   - b: pointer to an initialized Board.
- *   - d: pointer to a Die.
+ *   - plan: board, die and kernel (see sim_plan_create).
  *   - iterations: number of independent games to simulate.
  *   - max_steps: maximum rolls per game.
+ *   - seed: RNG seed; each game i gets its own stream (seed, i).
  *   Allocates and returns a Simulation struct containing:
  *     results: an array of GameResult of length iterations,
- *              where each GameResult has rolls_to_win and a dynamically
- *              allocated roll_sequence (or NULL if the game aborted).
+ *              where each GameResult has rolls_to_win, end_square and a bit-packed
+ *              roll_sequence stored in the simulation's arena
+ *              (or NULL if the game aborted).
  *   Caller is responsible for freeing the returned Simulation via sim_free().
  */
-Simulation *simulate_many(const Board *b,
-                          const Die *d,
+Simulation *simulate_many(const SimPlan *plan,
                           size_t iterations,
-                          size_t max_steps)
+                          size_t max_steps,
+                          uint64_t seed)
 {
     Simulation *S = malloc(sizeof(Simulation));
+    if (!S) return NULL;
     S->iterations = iterations;
     S->max_steps  = max_steps;
-    S->results    = malloc(iterations * sizeof(GameResult));
+    S->face_bits  = bits_for_sides(plan->d->sides);
+    S->results    = calloc(iterations, sizeof(GameResult));
+    /* first block sized for ~64 short games; the arena doubles from there */
+    S->arena      = arena_create(packed_bytes(64 * plan->b->size,
+                                              S->face_bits));
 
     /* Temporary buffer to record each game's rolls */
-    size_t *buffer = malloc(max_steps * sizeof(size_t));
+    size_t *buffer = malloc((max_steps ? max_steps : 1) * sizeof(size_t));
+    if (!S->results || !S->arena || !buffer) {
+        free(buffer);
+        sim_free(S);
+        return NULL;
+    }
     for (size_t i = 0; i < iterations; ++i) {
-        size_t r = simulate_one(b, d, buffer, max_steps);
+        Rng rng;
+        rng_seed(&rng, seed, i);
+        size_t end;
+        size_t r = sim_plan_play(plan, &rng, buffer, max_steps, &end);
         S->results[i].rolls_to_win = r;
+        S->results[i].end_square   = end;
         if (r > 0) {
-            /* Allocate and copy only the rolls actually used */
-            S->results[i].roll_sequence =
-                malloc(r * sizeof(size_t));
-            memcpy(S->results[i].roll_sequence,
-                   buffer,
-                   r * sizeof(size_t));
+            /* Pack only the rolls actually used into the arena */
+            uint8_t *packed =
+                arena_alloc(S->arena, packed_bytes(r, S->face_bits));
+            if (!packed) {
+                free(buffer);
+                sim_free(S);
+                return NULL;
+            }
+            pack_faces(packed, buffer, r, S->face_bits);
+            S->results[i].roll_sequence = packed;
         } else {
             /* Game aborted */
             S->results[i].roll_sequence = NULL;
@@ -77,17 +623,27 @@ Simulation *simulate_many(const Board *b,
     return S;
 }
 
+/*
+ * sim_sequence:
+ *   Decode game i's packed faces back to 1-based face values.
+ */
+size_t sim_sequence(const Simulation *S, size_t i, size_t *out) {
+    size_t r = S->results[i].rolls_to_win;
+    if (r > 0)
+        unpack_faces(out, S->results[i].roll_sequence, r, S->face_bits);
+    return r;
+}
+
 /*
  * sim_free:
  *   Free all memory associated with a Simulation.
- *   - Frees each GameResult.roll_sequence array (if non-NULL),
+ *   - Frees the arena (all packed roll sequences at once),
  *     then frees the results array and the Simulation struct itself.
  *   - Safe to call with a NULL pointer.
  */
 void sim_free(Simulation *S) {
     if (!S) return;
-    for (size_t i = 0; i < S->iterations; ++i)
-        free(S->results[i].roll_sequence);
+    arena_free(S->arena);
     free(S->results);
     free(S);
 }
@@ -1,19 +1,29 @@
 #ifndef SIM_H
 #define SIM_H
 
+#include <stdint.h>
+
+#include "arena.h"
 #include "board.h"
 #include "die.h"
+#include "rng.h"
 
 /*
  * GameResult:
  *   Stores the outcome of a single game simulation.
  *   - rolls_to_win: number of die rolls taken to reach the final square,
  *                   or 0 if the game was aborted (exceeded max_steps).
- *   - roll_sequence: array of face values rolled, length == rolls_to_win
+ *   - end_square:   square the game ended on: the last square for a win,
+ *                   a dead square if the game got stuck, otherwise wherever
+ *                   the token stood when max_steps ran out.
+ *   - roll_sequence: faces rolled, bit-packed with Simulation.face_bits bits
+ *                    per face (see bitpack.h); points into Simulation.arena,
+ *                    NULL for aborted games. Decode with sim_sequence().
  */
 typedef struct {
     size_t rolls_to_win;
-    size_t *roll_sequence;  /* length == rolls_to_win */
+    size_t end_square;
+    uint8_t *roll_sequence;  /* packed, rolls_to_win faces */
 } GameResult;
 
 /*
@@ -21,41 +31,235 @@ typedef struct {
  *   Aggregates the results of multiple game simulations.
  *   - iterations: number of games simulated.
  *   - max_steps:  maximum rolls allowed per game.
+ *   - face_bits:  bits per packed face (just enough for the die's sides).
  *   - results:    array of GameResult of length iterations.
+ *   - arena:      backing store for every roll_sequence; freed in one go.
  */
 typedef struct {
     size_t iterations;
     size_t max_steps;
+    unsigned face_bits;
     GameResult *results;    /* array of length iterations */
+    Arena *arena;           /* owns all packed roll sequences */
 } Simulation;
 
+/*
+ * SimKernel:
+ *   Strategy used to play games; every kernel produces statistically
+ *   identical games, they only differ in speed.
+ *   - SIM_KERNEL_AUTO:    pick the fastest kernel for the board and die.
+ *   - SIM_KERNEL_GENERIC: one die_roll and one adjacency lookup per roll
+ *                         (simulate_one).
+ *   - SIM_KERNEL_SKIP:    draw the number of rolls that leave the token in
+ *                         place with one geometric sample, then draw the
+ *                         next move from the faces that actually move.
+ *   - SIM_KERNEL_MULTI:   fair dice only; draw k rolls at once as one index
+ *                         into a precomputed k-roll transition table, so a
+ *                         game needs ~1/k as many dependent table lookups.
+ *   - SIM_KERNEL_FAIR:    fair d4/d6/d8/d12/d20 only; a variant compiled for
+ *                         the exact die size and win rule, with a constant
+ *                         divisor in the bounded draw and moves computed
+ *                         from b->mapping instead of the adjacency table.
+ */
+typedef enum {
+    SIM_KERNEL_AUTO,
+    SIM_KERNEL_GENERIC,
+    SIM_KERNEL_SKIP,
+    SIM_KERNEL_MULTI,
+    SIM_KERNEL_FAIR
+} SimKernel;
+
+struct SimPlan;
+
+/*
+ * SimPlayFn:
+ *   Signature shared by all kernels (same contract as simulate_one).
+ */
+typedef size_t (*SimPlayFn)(const struct SimPlan *p, Rng *rng,
+                            size_t *out_sequence, size_t max_steps,
+                            size_t *out_end);
+
+/*
+ * SIM_SKIP_MIN_STAY:
+ *   Stay probability from which the SKIP kernel replaces single rolls by a
+ *   geometric draw. Every skipped roll still draws its face for the
+ *   recorded sequence (in O(1), see SimFaces), so skipping only saves the
+ *   table walk per roll; that outweighs the log() of the geometric sample
+ *   only on squares where runs of ten or more wasted rolls are expected.
+ */
+#define SIM_SKIP_MIN_STAY 0.9
+
+/*
+ * SIM_SKIP_MIN_SHARE / SIM_SKIP_PILOT_GAMES / SIM_SKIP_PILOT_STEPS:
+ *   SIM_KERNEL_AUTO picks SKIP only if at least SIM_SKIP_MIN_SHARE of all
+ *   rolls are taken on squares it skips, estimated from a fixed-seed pilot
+ *   of SIM_SKIP_PILOT_GAMES games of at most SIM_SKIP_PILOT_STEPS rolls.
+ *   Every other roll pays for the extra stay test, so SKIP only beats
+ *   GENERIC when most rolls are skipped (break-even measured at ~2/3).
+ */
+#define SIM_SKIP_MIN_SHARE   0.75
+#define SIM_SKIP_PILOT_GAMES 256
+#define SIM_SKIP_PILOT_STEPS 4096
+
+/*
+ * SIM_MULTI_CACHE_BYTES:
+ *   Largest k-roll table SIM_KERNEL_AUTO will build; sized to stay resident
+ *   in a typical per-core L2 cache so the lookups stay cheap.
+ */
+#define SIM_MULTI_CACHE_BYTES (256u * 1024u)
+
+/*
+ * SIM_MULTI_FAIR_SQUARES:
+ *   When a FAIR variant exists for the die, SIM_KERNEL_AUTO still prefers
+ *   a 3-roll MULTI table, but a 2-roll table only on boards of at most
+ *   this many squares. On larger boards a game spreads over more table
+ *   rows and FAIR's single rolls were as fast or faster (measured with
+ *   d4-d20 on boards of 100 to 1600 squares).
+ */
+#define SIM_MULTI_FAIR_SQUARES 256
+
+/*
+ * SIM_MULTI_MAX_ROLLS:
+ *   Largest k considered for the k-roll table.
+ */
+#define SIM_MULTI_MAX_ROLLS 3
+
+/*
+ * SimFaces:
+ *   Per-square alias tables over a subset of the die's faces, e.g. those
+ *   that leave the token in place, conditioned on rolling one of them.
+ *   Square i owns the columns [i*sides, i*sides + count[i]); a draw picks
+ *   a uniform column c and returns face[c] with probability accept[c],
+ *   otherwise face[i*sides + alias[c]]. A fair die has accept 1 in every
+ *   column, so its draws cost one bounded integer.
+ */
+typedef struct {
+    uint32_t *count;   /* per square: faces in the subset */
+    uint32_t *face;    /* size × sides: face (1-based) of each column */
+    uint32_t *alias;   /* size × sides: alias column within the square */
+    double   *accept;  /* size × sides: probability of keeping face[c] */
+} SimFaces;
+
+/*
+ * SimPlan:
+ *   Per-run tables precomputed from a built Board and a Die.
+ *   - b, d:       the board and die the plan was built for (not owned).
+ *   - kernel:     kernel chosen by sim_plan_create (never AUTO).
+ *   - play:       the kernel function itself, resolved once at creation.
+ *   - stay_prob:  per square, probability that a roll leaves the token
+ *                 where it is (adj[i][f] == i), e.g. overshooting under -x.
+ *   - log_stay:   log1p(-move probability), the scale of the geometric
+ *                 draw; 0 where SKIP rolls normally.
+ *   - move:       per square, the faces that move the token, conditioned
+ *                 on moving.
+ *   - stay:       same for the faces that stay, used to record the exact
+ *                 faces of skipped rolls.
+ *   - multi_k:    rolls combined per MULTI table lookup (2 or 3).
+ *   - multi_span: sides^multi_k, the number of combined roll indices.
+ *   - multi:      size × multi_span entries; entry [i][c] describes rolling
+ *                 the faces encoded by c (base `sides`, first roll in the
+ *                 lowest digit) from square i: the low 24 bits hold the
+ *                 square reached, the high 8 bits the roll (1..k) after
+ *                 which the game ended early on the goal or a dead square,
+ *                 or 0 if all k rolls were used.
+ *   Tables of kernels that are not selected are NULL.
+ */
+typedef struct SimPlan {
+    const Board *b;
+    const Die   *d;
+    SimKernel    kernel;
+    SimPlayFn    play;
+    double      *stay_prob;
+    double      *log_stay;
+    SimFaces     move;
+    SimFaces     stay;
+    size_t       multi_k;
+    uint32_t     multi_span;
+    uint32_t    *multi;
+} SimPlan;
+
+/*
+ * sim_plan_create:
+ *   Precompute the tables for `kernel` on board b (graph already built)
+ *   with die d. SIM_KERNEL_AUTO selects SKIP when squares that keep the
+ *   token in place with probability of at least SIM_SKIP_MIN_STAY take
+ *   SIM_SKIP_MIN_SHARE of the rolls (typical under -x with a die about as
+ *   large as the board). Otherwise, for a fair die with a FAIR variant, it
+ *   selects MULTI if a table with k >= 2 fits in SIM_MULTI_CACHE_BYTES and
+ *   either k = 3 or the board has at most SIM_MULTI_FAIR_SQUARES squares,
+ *   else FAIR. Any other die gets MULTI when it is fair and a table fits,
+ *   GENERIC otherwise. A forced MULTI or FAIR falls back to GENERIC when
+ *   it does not apply to the die or board.
+ *   Returns NULL on allocation failure.
+ */
+SimPlan *sim_plan_create(const Board *b, const Die *d, SimKernel kernel);
+
+/*
+ * sim_plan_play:
+ *   Play one game with the plan's kernel. Same contract as simulate_one.
+ */
+size_t sim_plan_play(const SimPlan *p, Rng *rng,
+                     size_t *out_sequence, size_t max_steps,
+                     size_t *out_end);
+
+/*
+ * sim_kernel_name / sim_kernel_parse:
+ *   Convert between SimKernel values and their CLI names
+ *   ("auto", "generic", "skip", "multi", "fair"). sim_kernel_parse returns -1 for
+ *   an unknown name.
+ */
+const char *sim_kernel_name(SimKernel k);
+int sim_kernel_parse(const char *name, SimKernel *out);
+
+/*
+ * sim_plan_free:
+ *   Free a plan's tables. Safe to call with a NULL pointer.
+ */
+void sim_plan_free(SimPlan *p);
+
 /*
  * simulate_one:
  *   Play a single game on board b using die d.
+ *   - rng:          generator for this game's rolls.
  *   - out_sequence: caller-provided buffer of length max_steps to record each roll.
  *   - max_steps:    maximum number of rolls before aborting.
+ *   - out_end:      if non-NULL, receives the square the game ended on.
  *   Returns the number of rolls actually used to win (1..max_steps),
- *   or 0 if the game did not finish within max_steps.
+ *   or 0 if the game did not finish within max_steps or entered a dead
+ *   square (one from which the last square is unreachable).
  */
-size_t simulate_one(const Board *b, const Die *d,
-                    size_t *out_sequence, size_t max_steps);
+size_t simulate_one(const Board *b, const Die *d, Rng *rng,
+                    size_t *out_sequence, size_t max_steps,
+                    size_t *out_end);
 
 /*
  * simulate_many:
  *   Run multiple independent game simulations.
+ *   - plan:       board, die and kernel to play with.
  *   - iterations: number of games to simulate.
  *   - max_steps:  maximum rolls allowed per game.
- *   Allocates and returns a Simulation struct containing all GameResults.
+ *   - seed:       RNG seed; game i rolls from stream rng_seed(seed, i), so
+ *                 any subset of games can be reproduced on its own.
+ *   Allocates and returns a Simulation struct containing all GameResults,
+ *   or NULL on allocation failure.
  *   Caller must free the returned Simulation via sim_free().
  */
-Simulation *simulate_many(const Board *b, const Die *d,
-                          size_t iterations, size_t max_steps);
+Simulation *simulate_many(const SimPlan *plan,
+                          size_t iterations, size_t max_steps,
+                          uint64_t seed);
+
+/*
+ * sim_sequence:
+ *   Unpack the roll sequence of game i into out (room for max_steps faces).
+ *   Returns the game's rolls_to_win (0 for an aborted game).
+ */
+size_t sim_sequence(const Simulation *s, size_t i, size_t *out);
 
 /*
  * sim_free:
  *   Free all memory associated with a Simulation.
- *   - Frees each GameResult.roll_sequence, the results array,
- *     and the Simulation struct itself.
+ *   - Releases the arena holding every packed roll sequence, the results
+ *     array, and the Simulation struct itself (a constant number of frees).
  *   Safe to call with a NULL pointer.
  */
 void sim_free(Simulation *s);
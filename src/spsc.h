@@ -0,0 +1,66 @@
+#ifndef SPSC_H
+#define SPSC_H
+
+#include <stdatomic.h>
+#include <stddef.h>
+
+/*
+ * SpscRing:
+ *   Lock-free bounded queue of pointers between exactly one producer
+ *   thread and one consumer thread.
+ *   - head: next slot to read, written only by the consumer.
+ *   - tail: next slot to write, written only by the producer.
+ *   Both indices increase forever and are reduced modulo SPSC_CAPACITY
+ *   when a slot is addressed. They sit on separate cache lines so the two
+ *   threads do not contend for one line on every operation. The release
+ *   store of an index publishes the slot contents (and everything the
+ *   item points to) to the other side's acquire load.
+ */
+#define SPSC_CAPACITY 16    /* power of two */
+
+typedef struct {
+    _Alignas(64) atomic_size_t head;
+    _Alignas(64) atomic_size_t tail;
+    _Alignas(64) void *slots[SPSC_CAPACITY];
+} SpscRing;
+
+/*
+ * spsc_init:
+ *   Empty the ring. Must not race with spsc_push/spsc_pop.
+ */
+static inline void spsc_init(SpscRing *r) {
+    atomic_init(&r->head, 0);
+    atomic_init(&r->tail, 0);
+}
+
+/*
+ * spsc_push:
+ *   Producer side: append a non-NULL item.
+ *   Returns 1 on success, 0 if the ring is full.
+ */
+static inline int spsc_push(SpscRing *r, void *item) {
+    size_t tail = atomic_load_explicit(&r->tail, memory_order_relaxed);
+    size_t head = atomic_load_explicit(&r->head, memory_order_acquire);
+    if (tail - head == SPSC_CAPACITY)
+        return 0;
+    r->slots[tail & (SPSC_CAPACITY - 1)] = item;
+    atomic_store_explicit(&r->tail, tail + 1, memory_order_release);
+    return 1;
+}
+
+/*
+ * spsc_pop:
+ *   Consumer side: remove the oldest item.
+ *   Returns the item, or NULL if the ring is empty.
+ */
+static inline void *spsc_pop(SpscRing *r) {
+    size_t head = atomic_load_explicit(&r->head, memory_order_relaxed);
+    size_t tail = atomic_load_explicit(&r->tail, memory_order_acquire);
+    if (head == tail)
+        return NULL;
+    void *item = r->slots[head & (SPSC_CAPACITY - 1)];
+    atomic_store_explicit(&r->head, head + 1, memory_order_release);
+    return item;
+}
+
+#endif /* SPSC_H */
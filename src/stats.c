@@ -3,85 +3,105 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
-#include <limits.h>
 
 /*
- * stats_compute:
- *   Analyze the results of multiple game simulations to produce summary statistics.
- *   - b: pointer to the Board containing jump definitions.
- *   - sim: pointer to the Simulation with per-game results.
- *   Computes:
- *     1) Average number of rolls across all winning games.
- *     2) Identifies the single game with the fewest rolls to win, and records its roll sequence.
- *     3) Counts how often each snake/ladder jump was traversed across all games.
- *   Allocates and returns a Stats struct containing:
- *     - avg_rolls: mean rolls per win.
- *     - shortest_rolls and shortest_sequence: data for the fastest win.
- *     - jump_counts: array of length b->n_jumps with traversal counts.
- *     - total_jumps: sum of all jump traversals (for percentage calculations).
- *   Caller must free the returned Stats with stats_free().
+ * stats_create:
+ *   Allocate an empty accumulator.
+ *   - jump_counts is zeroed and sized to b->n_jumps,
+ *     stuck_counts is zeroed and sized to b->size.
+ *   - occupancy is zeroed, aligned to STATS_CACHE_LINE and rounded up to
+ *     whole cache lines, so per-thread accumulators can be updated in
+ *     parallel without false sharing.
+ *   - shortest_rolls/shortest_index start at the (size_t)-1 "infinite"
+ *     sentinel internally; shortest_rolls reads 0 until the first win.
+ *   - retain is only allocated if keep asks for any games.
  */
-Stats *stats_compute(const Board *b, const Simulation *sim)
+Stats *stats_create(const Board *b, RetainSpec keep)
 {
-    Stats *st = malloc(sizeof(Stats));
+    Stats *st = calloc(1, sizeof(Stats));
     if (!st) return NULL;
+    st->shortest_index = (size_t)-1;
+    st->jump_counts    = calloc(b->n_jumps ? b->n_jumps : 1, sizeof(size_t));
+    st->stuck_counts   = calloc(b->size, sizeof(size_t));
+    size_t bytes = (b->size * sizeof(size_t) + STATS_CACHE_LINE - 1)
+                 / STATS_CACHE_LINE * STATS_CACHE_LINE;
+    st->occupancy      = aligned_alloc(STATS_CACHE_LINE, bytes);
+    if (keep.k || keep.m)
+        st->retain     = retain_create(keep);
+    if (!st->jump_counts || !st->stuck_counts || !st->occupancy ||
+        ((keep.k || keep.m) && !st->retain)) {
+        stats_free(st);
+        return NULL;
+    }
+    memset(st->occupancy, 0, bytes);
+    return st;
+}
 
-    size_t wins        = 0;
-    size_t total_rolls = 0;
-    /* Use (size_t)-1 as “infinite” sentinel for finding minimum */
-    size_t shortest    = (size_t)-1;
-    size_t short_idx   = (size_t)-1;
+/*
+ * set_shortest:
+ *   Replace the recorded shortest game with (index, seq, rolls) if it is
+ *   strictly shorter, or equally short but earlier in the game order.
+ *   Returns 0 on success, -1 on allocation failure.
+ */
+static int set_shortest(Stats *st, size_t index,
+                        const size_t *seq, size_t rolls)
+{
+    if (st->shortest_sequence &&
+        (rolls > st->shortest_rolls ||
+         (rolls == st->shortest_rolls && index > st->shortest_index)))
+        return 0;
 
-    /* 1) Compute average rolls and locate the shortest-winning game */
-    for (size_t i = 0; i < sim->iterations; ++i) {
-        size_t r = sim->results[i].rolls_to_win;
-        if (r > 0) {
-            wins++;
-            total_rolls += r;
-            if (r < shortest) {
-                shortest  = r;
-                short_idx = i;
-            }
+    size_t *copy = realloc(st->shortest_sequence, rolls * sizeof(size_t));
+    if (!copy) return -1;
+    memcpy(copy, seq, rolls * sizeof(size_t));
+    st->shortest_sequence = copy;
+    st->shortest_rolls    = rolls;
+    st->shortest_index    = index;
+    return 0;
+}
+
+/*
+ * stats_add_game:
+ *   Fold one game into the running statistics.
+ *   - Every game is offered to the retained examples, if any.
+ *   - Aborted games (rolls == 0) only bump the game counter, plus the
+ *     stuck counters if they ended on a dead square.
+ *   - Winning games update the roll total/average and the shortest game,
+ *     then their roll sequence is replayed to count jump traversals and
+ *     the square every roll ends on.
+ */
+int stats_add_game(Stats *st, const Board *b, size_t index,
+                   const size_t *seq, size_t rolls, size_t end)
+{
+    st->games++;
+    if (st->retain && retain_add(st->retain, index, seq, rolls, end) != 0)
+        return -1;
+    if (rolls == 0) {
+        if (b->dead[end]) {
+            st->stuck_games++;
+            st->stuck_counts[end]++;
         }
+        return 0;
     }
 
-    st->avg_rolls = wins
-        ? (double)total_rolls / wins
-        : 0.0;
+    st->wins++;
+    st->total_rolls += rolls;
+    st->avg_rolls = (double)st->total_rolls / st->wins;
 
-    /* Copy the roll sequence of the fastest win, if any */
-    if (short_idx < sim->iterations) {
-        st->shortest_rolls    = shortest;
-        st->shortest_sequence = malloc(shortest * sizeof(size_t));
-        memcpy(
-            st->shortest_sequence,
-            sim->results[short_idx].roll_sequence,
-            shortest * sizeof(size_t)
-        );
-    } else {
-        st->shortest_rolls    = 0;
-        st->shortest_sequence = NULL;
-    }
+    if (set_shortest(st, index, seq, rolls) != 0)
+        return -1;
 
-    /* 2) Count jump traversals across all games */
-    st->jump_counts = calloc(b->n_jumps, sizeof(size_t));
-    st->total_jumps = 0;
-
-    for (size_t i = 0; i < sim->iterations; ++i) {
-        size_t pos = 0;
-        size_t len = sim->results[i].rolls_to_win;
-        size_t *seq = sim->results[i].roll_sequence;
-
-        for (size_t j = 0; j < len; ++j) {
-            size_t face = seq[j];
-            size_t raw  = pos + face;
-            /* Apply win-by-exceed logic: clamp to last square if needed */
-            size_t dest = (raw >= b->size)
-                        ? b->size - 1
-                        : raw;
-            /* Then apply any snake/ladder jump mapping */
-            dest = b->mapping[dest];
+    /* Replay the game to count jump traversals and occupancy */
+    size_t pos = 0;
+    for (size_t j = 0; j < rolls; ++j) {
+        size_t face = seq[j];
+        size_t raw  = pos + face;
+        /* Follow the built graph, so overshoots obey the win rule
+           (clamp to the last square, or stay put under -x) */
+        size_t dest = b->adj[pos][face-1];
 
+        /* Only a roll landing on a jump start can traverse a jump */
+        if (raw < b->size && b->mapping[raw] != raw) {
             /* Check each defined jump to see if it matches this move */
             for (size_t k = 0; k < b->n_jumps; ++k) {
                 if (b->jumps[k].start == raw &&
@@ -90,54 +110,340 @@ Stats *stats_compute(const Board *b, const Simulation *sim)
                     st->total_jumps++;
                 }
             }
-            pos = dest;
         }
+        st->occupancy[dest]++;
+        pos = dest;
     }
+    return 0;
+}
 
+/*
+ * stats_merge:
+ *   Combine two accumulators.
+ *   - Counters, jump counts and occupancy are summed; the average is
+ *     recomputed.
+ *   - The shortest game follows the same (rolls, index) order as
+ *     stats_add_game, so merge order does not change the result; the
+ *     retained games are merged by retain_merge, which is order-free too.
+ */
+int stats_merge(Stats *dst, const Stats *src, const Board *b)
+{
+    dst->games       += src->games;
+    dst->wins        += src->wins;
+    dst->total_rolls += src->total_rolls;
+    dst->avg_rolls    = dst->wins
+        ? (double)dst->total_rolls / dst->wins
+        : 0.0;
+
+    if (src->shortest_sequence &&
+        set_shortest(dst, src->shortest_index,
+                     src->shortest_sequence, src->shortest_rolls) != 0)
+        return -1;
+
+    for (size_t k = 0; k < b->n_jumps; ++k)
+        dst->jump_counts[k] += src->jump_counts[k];
+    dst->total_jumps += src->total_jumps;
+
+    for (size_t i = 0; i < b->size; ++i)
+        dst->stuck_counts[i] += src->stuck_counts[i];
+    dst->stuck_games += src->stuck_games;
+
+    for (size_t i = 0; i < b->size; ++i)
+        dst->occupancy[i] += src->occupancy[i];
+
+    if (src->retain && !dst->retain &&
+        !(dst->retain = retain_create(src->retain->spec)))
+        return -1;
+    if (src->retain && retain_merge(dst->retain, src->retain) != 0)
+        return -1;
+    return 0;
+}
+
+/*
+ * stats_compute:
+ *   Analyze the results of multiple game simulations to produce summary statistics.
+ *   - b: pointer to the Board containing jump definitions.
+ *   - sim: pointer to the Simulation with per-game results.
+ *   - keep: example games to retain.
+ *   Unpacks every GameResult, in order, and feeds it through stats_add_game,
+ *   which computes:
+ *     1) Average number of rolls across all winning games.
+ *     2) The single game with the fewest rolls to win, and its roll sequence.
+ *     3) How often each snake/ladder jump was traversed across all games.
+ *   Caller must free the returned Stats with stats_free().
+ */
+Stats *stats_compute(const Board *b, const Simulation *sim, RetainSpec keep)
+{
+    Stats *st = stats_create(b, keep);
+    size_t *seq = malloc((sim->max_steps ? sim->max_steps : 1)
+                         * sizeof(size_t));
+    if (!st || !seq) {
+        free(seq);
+        stats_free(st);
+        return NULL;
+    }
+
+    for (size_t i = 0; i < sim->iterations; ++i) {
+        size_t r = sim_sequence(sim, i, seq);
+        if (stats_add_game(st, b, i, seq, r,
+                           sim->results[i].end_square) != 0) {
+            free(seq);
+            stats_free(st);
+            return NULL;
+        }
+    }
+    free(seq);
     return st;
 }
 
 /*
- * stats_print:
- *   Display computed statistics to stdout.
+ * stats_write:
+ *   Write the accumulator as keyword-prefixed text lines:
+ *     games <n> wins <n> rolls <n>
+ *     shortest <index> <rolls> <face>...
+ *     jumps <total> <count>...
+ *     stuck <total> <n> (<square> <count>)...   (only squares with count > 0)
+ *     occupancy <n> (<square> <count>)...       (only squares with count > 0)
+ *     retain ...                                (see retain_write)
+ *   An accumulator without retained games writes "retain 0 0 0 0 0 0".
+ *   Returns 0 on success, -1 if the stream reported a write error.
+ */
+int stats_write(FILE *f, const Stats *st, const Board *b)
+{
+    fprintf(f, "games %zu wins %zu rolls %zu\n",
+            st->games, st->wins, st->total_rolls);
+
+    fprintf(f, "shortest %zu %zu",
+            st->shortest_index, st->shortest_rolls);
+    for (size_t i = 0; i < st->shortest_rolls; ++i)
+        fprintf(f, " %zu", st->shortest_sequence[i]);
+    fprintf(f, "\n");
+
+    fprintf(f, "jumps %zu", st->total_jumps);
+    for (size_t k = 0; k < b->n_jumps; ++k)
+        fprintf(f, " %zu", st->jump_counts[k]);
+    fprintf(f, "\n");
+
+    size_t n_stuck = 0;
+    for (size_t i = 0; i < b->size; ++i)
+        if (st->stuck_counts[i]) n_stuck++;
+    fprintf(f, "stuck %zu %zu", st->stuck_games, n_stuck);
+    for (size_t i = 0; i < b->size; ++i)
+        if (st->stuck_counts[i])
+            fprintf(f, " %zu %zu", i, st->stuck_counts[i]);
+    fprintf(f, "\n");
+
+    size_t n_occupied = 0;
+    for (size_t i = 0; i < b->size; ++i)
+        if (st->occupancy[i]) n_occupied++;
+    fprintf(f, "occupancy %zu", n_occupied);
+    for (size_t i = 0; i < b->size; ++i)
+        if (st->occupancy[i])
+            fprintf(f, " %zu %zu", i, st->occupancy[i]);
+    fprintf(f, "\n");
+
+    if (st->retain)
+        return retain_write(f, st->retain);
+    fprintf(f, "retain 0 0 0 0 0 0\n");
+    return ferror(f) ? -1 : 0;
+}
+
+/*
+ * stats_read:
+ *   Parse the format produced by stats_write back into a new Stats.
+ *   The jump list must have exactly b->n_jumps entries. The retention
+ *   policy is the one stored in the stream.
+ */
+Stats *stats_read(FILE *f, const Board *b)
+{
+    Stats *st = stats_create(b, (RetainSpec){ 0, 0, 0 });
+    if (!st) return NULL;
+
+    size_t shortest_rolls;
+    if (fscanf(f, " games %zu wins %zu rolls %zu",
+               &st->games, &st->wins, &st->total_rolls) != 3 ||
+        fscanf(f, " shortest %zu %zu",
+               &st->shortest_index, &shortest_rolls) != 2)
+        goto fail;
+
+    if (shortest_rolls > 0) {
+        st->shortest_sequence = malloc(shortest_rolls * sizeof(size_t));
+        if (!st->shortest_sequence) goto fail;
+        st->shortest_rolls = shortest_rolls;
+        for (size_t i = 0; i < shortest_rolls; ++i)
+            if (fscanf(f, "%zu", &st->shortest_sequence[i]) != 1)
+                goto fail;
+    }
+
+    if (fscanf(f, " jumps %zu", &st->total_jumps) != 1)
+        goto fail;
+    for (size_t k = 0; k < b->n_jumps; ++k)
+        if (fscanf(f, "%zu", &st->jump_counts[k]) != 1)
+            goto fail;
+
+    size_t n_stuck;
+    if (fscanf(f, " stuck %zu %zu", &st->stuck_games, &n_stuck) != 2)
+        goto fail;
+    for (size_t i = 0; i < n_stuck; ++i) {
+        size_t sq, cnt;
+        if (fscanf(f, "%zu %zu", &sq, &cnt) != 2 || sq >= b->size)
+            goto fail;
+        st->stuck_counts[sq] = cnt;
+    }
+
+    size_t n_occupied;
+    if (fscanf(f, " occupancy %zu", &n_occupied) != 1)
+        goto fail;
+    for (size_t i = 0; i < n_occupied; ++i) {
+        size_t sq, cnt;
+        if (fscanf(f, "%zu %zu", &sq, &cnt) != 2 || sq >= b->size)
+            goto fail;
+        st->occupancy[sq] = cnt;
+    }
+
+    st->retain = retain_read(f);
+    if (!st->retain)
+        goto fail;
+    if (st->retain->spec.k == 0 && st->retain->spec.m == 0) {
+        retain_free(st->retain);
+        st->retain = NULL;
+    }
+
+    st->avg_rolls = st->wins
+        ? (double)st->total_rolls / st->wins
+        : 0.0;
+    return st;
+
+fail:
+    stats_free(st);
+    return NULL;
+}
+
+/*
+ * print_dead:
+ *   The dead-square part of stats_fprint.
+ */
+static void print_dead(FILE *out, const Stats *st, const Board *b) {
+    /* squares from which the goal cannot be reached under these rules */
+    fprintf(out, "\nDead squares (goal unreachable):");
+    for (size_t i = 0; i < b->size; ++i)
+        if (b->dead[i] && (b->mapping[i] == i || i == 0))
+            fprintf(out, " %zu", i);
+    double stuck_pct = st->games
+                     ? 100.0 * st->stuck_games / (double)st->games
+                     : 0.0;
+    fprintf(out, "\nGames ending in a dead square: %zu of %zu  (%5.2f%%)\n",
+            st->stuck_games, st->games, stuck_pct);
+    for (size_t i = 0; i < b->size; ++i) {
+        if (!st->stuck_counts[i])
+            continue;
+        fprintf(out, "  %3zu      : %6zu times  (%5.2f%%)\n",
+                i, st->stuck_counts[i],
+                100.0 * st->stuck_counts[i] / (double)st->games);
+    }
+}
+
+/*
+ * stats_fprint:
+ *   Display computed statistics on `out`.
  *   - st: pointer to Stats produced by stats_compute.
  *   - b: pointer to Board (for jump definitions and ordering).
  *   Prints:
  *     - Average rolls to win (to two decimal places).
  *     - The roll sequence of the shortest game.
  *     - For each jump, the count of traversals and the percentage of all jumps.
+ *     - If the board has dead squares: their list, and for each one the
+ *       fraction of games that got stuck there (the probability mass that
+ *       never reaches the goal).
+ *     - The retained example games, if any.
  */
-void stats_print(const Stats *st, const Board *b) {
-    printf("Average rolls to win: %.2f\n", st->avg_rolls);
+void stats_fprint(FILE *out, const Stats *st, const Board *b) {
+    fprintf(out, "Average rolls to win: %.2f\n", st->avg_rolls);
 
-    printf("Shortest game (%zu rolls):",
-           st->shortest_rolls);
+    fprintf(out, "Shortest game (%zu rolls):",
+            st->shortest_rolls);
     for (size_t i = 0; i < st->shortest_rolls; ++i)
-        printf(" %zu", st->shortest_sequence[i]);
-    printf("\n\nJump traversal counts:\n");
+        fprintf(out, " %zu", st->shortest_sequence[i]);
+    fprintf(out, "\n\nJump traversal counts:\n");
 
     for (size_t k = 0; k < b->n_jumps; ++k) {
         double pct = st->total_jumps
                    ? 100.0 * st->jump_counts[k]
                      / (double)st->total_jumps
                    : 0.0;
-        printf("  %3zu→%-3zu : %6zu times  (%5.2f%%)\n",
-               b->jumps[k].start,
-               b->jumps[k].end,
-               st->jump_counts[k],
-               pct);
+        fprintf(out, "  %3zu→%-3zu : %6zu times  (%5.2f%%)\n",
+                b->jumps[k].start,
+                b->jumps[k].end,
+                st->jump_counts[k],
+                pct);
     }
+
+    if (b->n_dead > 0)
+        print_dead(out, st, b);
+    if (st->retain)
+        retain_fprint(out, st->retain);
+}
+
+/*
+ * stats_print:
+ *   stats_fprint to stdout.
+ */
+void stats_print(const Stats *st, const Board *b) {
+    stats_fprint(stdout, st, b);
 }
 
 /*
  * stats_free:
  *   Release all memory associated with a Stats struct.
- *   - Frees the shortest_sequence array, the jump_counts array, and the Stats struct itself.
+ *   - Frees the shortest_sequence array, the jump_counts, stuck_counts and
+ *     occupancy arrays, the retained games, and the Stats struct itself.
  *   - Safe to call with a NULL pointer.
  */
 void stats_free(Stats *st) {
     if (!st) return;
     free(st->shortest_sequence);
     free(st->jump_counts);
+    free(st->stuck_counts);
+    free(st->occupancy);
+    retain_free(st->retain);
     free(st);
 }
+
+/*
+ * write_grid:
+ *   Print one value per square, b->M per line, row by row.
+ */
+static void write_grid(FILE *f, const Board *b, const double *v) {
+    for (size_t r = 0; r < b->N; ++r) {
+        for (size_t c = 0; c < b->M; ++c)
+            fprintf(f, "%s%8.4f", c ? " " : "", v[r * b->M + c]);
+        fprintf(f, "\n");
+    }
+}
+
+/*
+ * stats_write_heatmap:
+ *   Comment lines start with '#'; each grid is preceded by one, so the file
+ *   can be fed to most plotting tools block by block. Simulated values are
+ *   occupancy counts divided by the number of wins (all 0 without wins).
+ */
+int stats_write_heatmap(FILE *f, const Stats *st, const Board *b,
+                        const double *expected)
+{
+    double *sim = malloc(b->size * sizeof(double));
+    if (!sim) return -1;
+    for (size_t i = 0; i < b->size; ++i)
+        sim[i] = st->wins ? (double)st->occupancy[i] / st->wins : 0.0;
+
+    fprintf(f, "# landings per winning game, %zu rows x %zu columns "
+               "(row r = squares r*%zu .. r*%zu+%zu)\n",
+            b->N, b->M, b->M, b->M, b->M - 1);
+    fprintf(f, "# simulated (%zu winning games)\n", st->wins);
+    write_grid(f, b, sim);
+    if (expected) {
+        fprintf(f, "\n# exact (Markov chain)\n");
+        write_grid(f, b, expected);
+    }
+    free(sim);
+    return ferror(f) ? -1 : 0;
+}
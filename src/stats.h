@@ -1,38 +1,112 @@
 #ifndef STATS_H
 #define STATS_H
 
+#include <stdio.h>
+
 #include "board.h"
+#include "retain.h"
 #include "sim.h"
 
+/*
+ * STATS_CACHE_LINE:
+ *   Alignment and size granularity of the occupancy counters.
+ */
+#define STATS_CACHE_LINE 64
+
 /*
  * Stats:
  *   Holds summary statistics computed from a set of game simulations.
+ *   The struct doubles as a running accumulator: games can be added one at a
+ *   time and partial results (e.g. from shards) merged together.
+ *   - games:            Number of games added (won or aborted).
+ *   - wins:             Number of games that reached the last square.
+ *   - total_rolls:      Sum of rolls over all winning games.
  *   - avg_rolls:        Average number of rolls taken across all winning games.
  *   - shortest_rolls:   Number of rolls in the quickest (fewest-roll) winning game.
+ *   - shortest_index:   Game index of that win; ties go to the lowest index so
+ *                       merged shards pick the same game as a single run.
  *   - shortest_sequence: Array of face values rolled in the quickest win
  *                        (length == shortest_rolls), or NULL if no wins.
  *   - jump_counts:      Array counting how many times each snake/ladder jump
  *                        was traversed (length == b->n_jumps).
  *   - total_jumps:      Total number of jump traversals across all games
  *                        (for percentage calculations).
+ *   - stuck_games:      Games that ended early in a dead square.
+ *   - stuck_counts:     Per square, how many games ended stuck there
+ *                        (length == b->size).
+ *   - occupancy:        Per square, how many rolls of winning games ended
+ *                        there, after jumps (length == b->size). Sums to
+ *                        total_rolls. Allocated on its own cache lines so
+ *                        accumulators of concurrent threads never share one.
+ *   - retain:           Retained example games (k shortest, k longest, a
+ *                        sample of m), or NULL if none are kept.
  */
 typedef struct {
+    size_t games;
+    size_t wins;
+    size_t total_rolls;
     double avg_rolls;
     size_t shortest_rolls;
+    size_t shortest_index;
     size_t *shortest_sequence;    /* length == shortest_rolls */
     size_t *jump_counts;          /* length == b->n_jumps */
     size_t total_jumps;
+    size_t stuck_games;
+    size_t *stuck_counts;         /* length == b->size */
+    size_t *occupancy;            /* length == b->size, cache-line padded */
+    Retain *retain;               /* NULL unless created with a RetainSpec */
 } Stats;
 
+/*
+ * stats_create:
+ *   Allocate an empty Stats accumulator for board b (no games yet) that
+ *   retains the example games described by `keep` ({0, 0, 0} for none).
+ *   Returns NULL on allocation failure.
+ */
+Stats *stats_create(const Board *b, RetainSpec keep);
+
+/*
+ * stats_add_game:
+ *   Fold one finished game into the accumulator.
+ *   - index: global game index (used to break shortest-game ties).
+ *   - seq:   faces rolled, length == rolls (ignored when rolls == 0).
+ *   - rolls: rolls taken to win, or 0 if the game was aborted.
+ *   - end:   square the game ended on; an aborted game ending on a dead
+ *            square is counted as stuck there.
+ *   Returns 0 on success, -1 on allocation failure.
+ */
+int stats_add_game(Stats *st, const Board *b, size_t index,
+                   const size_t *seq, size_t rolls, size_t end);
+
+/*
+ * stats_merge:
+ *   Add all games accumulated in src into dst (src is left untouched).
+ *   The result equals accumulating both game sets into a single Stats.
+ *   If dst retains nothing but src does, dst starts retaining with src's
+ *   RetainSpec.
+ *   Returns 0 on success, -1 on allocation failure.
+ */
+int stats_merge(Stats *dst, const Stats *src, const Board *b);
+
+/*
+ * stats_write / stats_read:
+ *   Serialize an accumulator as text lines (used by checkpoints).
+ *   stats_read returns a newly allocated Stats, or NULL on a malformed
+ *   stream or allocation failure.
+ */
+int stats_write(FILE *f, const Stats *st, const Board *b);
+Stats *stats_read(FILE *f, const Board *b);
+
 /*
  * stats_compute:
  *   Analyze simulation results to produce summary statistics.
  *   - b:   Pointer to the Board (for jump definitions).
  *   - sim: Pointer to the Simulation containing game results.
+ *   - keep: Example games to retain (see stats_create).
  *   Returns a newly allocated Stats struct (or NULL on failure).
  *   Caller must free the returned Stats via stats_free().
  */
-Stats *stats_compute(const Board *b, const Simulation *sim);
+Stats *stats_compute(const Board *b, const Simulation *sim, RetainSpec keep);
 
 /*
  * stats_print:
@@ -42,11 +116,29 @@ Stats *stats_compute(const Board *b, const Simulation *sim);
  */
 void stats_print(const Stats *st, const Board *b);
 
+/*
+ * stats_fprint:
+ *   Same as stats_print, but write to `out` (e.g. a memory stream whose
+ *   text is sent back to a client).
+ */
+void stats_fprint(FILE *out, const Stats *st, const Board *b);
+
+/*
+ * stats_write_heatmap:
+ *   Write the occupancy per winning game as an N×M grid (b->N rows of b->M
+ *   columns, row r holding squares r*M .. r*M+M-1), followed by the exact
+ *   grid `expected` (see markov_expected_visits) if it is non-NULL.
+ *   Returns 0 on success, -1 if the stream reported a write error.
+ */
+int stats_write_heatmap(FILE *f, const Stats *st, const Board *b,
+                        const double *expected);
+
 /*
  * stats_free:
  *   Free all memory associated with a Stats object.
- *   - Frees the shortest_sequence array, the jump_counts array,
- *     and the Stats struct itself.
+ *   - Frees the shortest_sequence array, the jump_counts, stuck_counts
+ *     and occupancy arrays, the retained games, and the Stats struct
+ *     itself.
  *   Safe to call with a NULL pointer.
  */
 void stats_free(Stats *s);
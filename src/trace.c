@@ -0,0 +1,361 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include "trace.h"
+#include "bitpack.h"
+
+#include <fcntl.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#define TRACE_MAGIC       "PFTRACE"     /* 7 chars + NUL = 8 bytes */
+#define TRACE_VERSION     2
+#define TRACE_HEADER_SIZE 64
+#define TRACE_BUFFER_SIZE (1u << 20)    /* bytes buffered per fwrite */
+
+/*
+ * put_u32 / put_u64 / get_u32 / get_u64:
+ *   Little-endian integer (de)serialization independent of host byte order.
+ */
+static void put_u32(uint8_t *p, uint32_t v) {
+    for (int i = 0; i < 4; ++i) p[i] = (uint8_t)(v >> (8 * i));
+}
+static void put_u64(uint8_t *p, uint64_t v) {
+    for (int i = 0; i < 8; ++i) p[i] = (uint8_t)(v >> (8 * i));
+}
+static uint32_t get_u32(const uint8_t *p) {
+    uint32_t v = 0;
+    for (int i = 0; i < 4; ++i) v |= (uint32_t)p[i] << (8 * i);
+    return v;
+}
+static uint64_t get_u64(const uint8_t *p) {
+    uint64_t v = 0;
+    for (int i = 0; i < 8; ++i) v |= (uint64_t)p[i] << (8 * i);
+    return v;
+}
+
+/*
+ * write_header:
+ *   Serialize the writer's header fields into a 64-byte block at the
+ *   current file position.
+ */
+static int write_header(TraceWriter *w, uint64_t index_offset) {
+    uint8_t h[TRACE_HEADER_SIZE] = {0};
+    memcpy(h, TRACE_MAGIC, sizeof TRACE_MAGIC);
+    put_u32(h + 8,  TRACE_VERSION);
+    put_u32(h + 12, w->face_bits);
+    put_u64(h + 16, w->die_sides);
+    put_u64(h + 24, w->board_size);
+    put_u64(h + 32, w->first_game);
+    put_u64(h + 40, w->n_games);
+    put_u64(h + 48, index_offset);
+    put_u32(h + 56, TRACE_BLOCK_GAMES);
+    return fwrite(h, 1, sizeof h, w->f) == sizeof h ? 0 : -1;
+}
+
+/*
+ * flush_buffer:
+ *   Hand all pending bytes to the file in one fwrite.
+ */
+static int flush_buffer(TraceWriter *w) {
+    if (w->len && fwrite(w->buf, 1, w->len, w->f) != w->len)
+        return -1;
+    w->written += w->len;
+    w->len = 0;
+    return 0;
+}
+
+/*
+ * trace_create:
+ *   Open the file, write a provisional header (n_games and index_offset
+ *   are patched by trace_close) and allocate the write buffer.
+ */
+TraceWriter *trace_create(const char *path, size_t die_sides,
+                          size_t board_size, size_t first_game)
+{
+    TraceWriter *w = calloc(1, sizeof(TraceWriter));
+    if (!w) return NULL;
+    w->f          = fopen(path, "wb");
+    /* the file is fully buffered by w->buf; stdio buffering is redundant.
+     * setvbuf must come before any other operation on the stream */
+    if (w->f)
+        setvbuf(w->f, NULL, _IONBF, 0);
+    w->cap        = TRACE_BUFFER_SIZE;
+    w->buf        = malloc(w->cap);
+    w->die_sides  = die_sides;
+    w->board_size = board_size;
+    w->first_game = first_game;
+    w->face_bits  = bits_for_sides(die_sides);
+    if (!w->f || !w->buf || write_header(w, 0) != 0) {
+        if (w->f) fclose(w->f);
+        free(w->buf);
+        free(w);
+        return NULL;
+    }
+    w->written = TRACE_HEADER_SIZE;
+    return w;
+}
+
+/*
+ * trace_write_game:
+ *   - Starts a new block (recording its file offset) every
+ *     TRACE_BLOCK_GAMES games.
+ *   - Flushes the buffer when the encoded game would not fit, growing it
+ *     only for games longer than the whole buffer.
+ */
+int trace_write_game(TraceWriter *w, const size_t *seq, size_t rolls,
+                     size_t end)
+{
+    if (w->n_games % TRACE_BLOCK_GAMES == 0) {
+        if (w->n_blocks == w->blocks_cap) {
+            size_t cap = w->blocks_cap ? w->blocks_cap * 2 : 64;
+            uint64_t *tmp = realloc(w->offsets, cap * sizeof(uint64_t));
+            if (!tmp) return -1;
+            w->offsets    = tmp;
+            w->blocks_cap = cap;
+        }
+        w->offsets[w->n_blocks++] = w->written + w->len;
+    }
+
+    size_t need = 20 + packed_bytes(rolls, w->face_bits);
+    if (w->len + need > w->cap) {
+        if (flush_buffer(w) != 0) return -1;
+        if (need > w->cap) {
+            uint8_t *tmp = realloc(w->buf, need);
+            if (!tmp) return -1;
+            w->buf = tmp;
+            w->cap = need;
+        }
+    }
+    w->len += varint_put(w->buf + w->len, rolls);
+    if (rolls == 0)
+        w->len += varint_put(w->buf + w->len, end);
+    w->len += pack_faces(w->buf + w->len, seq, rolls, w->face_bits);
+    w->n_games++;
+    return 0;
+}
+
+/*
+ * trace_close:
+ *   Append the block index after the last block, then rewrite the header
+ *   with the final game count and index offset.
+ */
+int trace_close(TraceWriter *w) {
+    int err = flush_buffer(w);
+    uint64_t index_offset = w->written;
+
+    for (size_t i = 0; !err && i < w->n_blocks; ++i) {
+        uint8_t off[8];
+        put_u64(off, w->offsets[i]);
+        if (fwrite(off, 1, sizeof off, w->f) != sizeof off)
+            err = -1;
+    }
+    if (!err && (fseek(w->f, 0, SEEK_SET) != 0 ||
+                 write_header(w, index_offset) != 0))
+        err = -1;
+    if (fclose(w->f) != 0)
+        err = -1;
+
+    free(w->offsets);
+    free(w->buf);
+    free(w);
+    return err;
+}
+
+/*
+ * trace_open:
+ *   Map the whole file read-only and check that the header, block size and
+ *   index all lie within the mapping.
+ */
+TraceReader *trace_open(const char *path) {
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) return NULL;
+
+    struct stat sb;
+    if (fstat(fd, &sb) != 0 || (size_t)sb.st_size < TRACE_HEADER_SIZE) {
+        close(fd);
+        return NULL;
+    }
+    size_t size = (size_t)sb.st_size;
+    void *map = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) return NULL;
+
+    TraceReader *r = calloc(1, sizeof(TraceReader));
+    if (!r) {
+        munmap(map, size);
+        return NULL;
+    }
+    const uint8_t *h = map;
+    r->base        = map;
+    r->size        = size;
+    r->face_bits   = get_u32(h + 12);
+    r->die_sides   = get_u64(h + 16);
+    r->board_size  = get_u64(h + 24);
+    r->first_game  = get_u64(h + 32);
+    r->n_games     = get_u64(h + 40);
+    uint64_t index_offset = get_u64(h + 48);
+    r->block_games = get_u32(h + 56);
+
+    int ok = memcmp(h, TRACE_MAGIC, sizeof TRACE_MAGIC) == 0 &&
+             get_u32(h + 8) == TRACE_VERSION &&
+             r->block_games > 0 &&
+             r->face_bits > 0 && r->face_bits <= 32;
+    if (ok) {
+        r->n_blocks = (size_t)((r->n_games + r->block_games - 1)
+                               / r->block_games);
+        ok = index_offset >= TRACE_HEADER_SIZE &&
+             index_offset <= size &&
+             r->n_blocks <= (size - index_offset) / 8;
+    }
+    if (!ok) {
+        trace_close_reader(r);
+        return NULL;
+    }
+    r->index = r->base + index_offset;
+
+    /* analysis walks blocks front to back */
+    posix_madvise(map, size, POSIX_MADV_SEQUENTIAL);
+    return r;
+}
+
+/*
+ * decode_game:
+ *   Decode the game at *p (bounded by end) into *seq, advancing *p, and
+ *   store its final square in *square.
+ *   Returns the roll count or (size_t)-1 on truncated data or a face
+ *   outside 1..die_sides (it would index past an adjacency row).
+ */
+static size_t decode_game(const TraceReader *r,
+                          const uint8_t **p, const uint8_t *end,
+                          size_t **seq, size_t *cap, size_t *square)
+{
+    uint64_t rolls;
+    size_t n = varint_get(*p, end, &rolls);
+    if (n == 0 || rolls > (uint64_t)(end - *p - n) * 8 / r->face_bits)
+        return (size_t)-1;
+    *p += n;
+
+    if (rolls == 0) {
+        uint64_t sq;
+        n = varint_get(*p, end, &sq);
+        if (n == 0 || sq >= r->board_size)
+            return (size_t)-1;
+        *p += n;
+        *square = (size_t)sq;
+        return 0;
+    }
+    *square = (size_t)r->board_size - 1;
+
+    if (rolls > *cap) {
+        size_t *tmp = realloc(*seq, rolls * sizeof(size_t));
+        if (!tmp) return (size_t)-1;
+        *seq = tmp;
+        *cap = rolls;
+    }
+    *p += unpack_faces(*seq, *p, rolls, r->face_bits);
+    for (size_t i = 0; i < rolls; ++i)
+        if ((*seq)[i] == 0 || (*seq)[i] > r->die_sides)
+            return (size_t)-1;
+    return (size_t)rolls;
+}
+
+/*
+ * block_bounds:
+ *   Return the [start, end) byte range of block `blk`, or 0 if the index
+ *   entry points outside the data area.
+ */
+static int block_bounds(const TraceReader *r, size_t blk,
+                        const uint8_t **start, const uint8_t **end)
+{
+    uint64_t lo = get_u64(r->index + 8 * blk);
+    uint64_t hi = (blk + 1 < r->n_blocks)
+                ? get_u64(r->index + 8 * (blk + 1))
+                : (uint64_t)(r->index - r->base);
+    if (lo < TRACE_HEADER_SIZE || lo > hi ||
+        hi > (uint64_t)(r->index - r->base))
+        return 0;
+    *start = r->base + lo;
+    *end   = r->base + hi;
+    return 1;
+}
+
+/*
+ * trace_game:
+ *   Locate the block through the index and skip the preceding games of
+ *   that block (at most block_games - 1 varint + packed skips).
+ */
+size_t trace_game(const TraceReader *r, size_t game,
+                  size_t **seq, size_t *cap, size_t *end_square)
+{
+    if (game < r->first_game || game - r->first_game >= r->n_games)
+        return (size_t)-1;
+    size_t local = game - (size_t)r->first_game;
+    size_t blk   = local / r->block_games;
+
+    const uint8_t *p, *end;
+    if (!block_bounds(r, blk, &p, &end))
+        return (size_t)-1;
+
+    for (size_t i = 0; i < local % r->block_games; ++i) {
+        uint64_t rolls;
+        size_t n = varint_get(p, end, &rolls);
+        if (n == 0) return (size_t)-1;
+        p += n;
+        size_t skip = packed_bytes((size_t)rolls, r->face_bits);
+        if (rolls == 0) {
+            uint64_t sq;
+            skip = varint_get(p, end, &sq);
+            if (skip == 0) return (size_t)-1;
+        }
+        if (skip > (size_t)(end - p)) return (size_t)-1;
+        p += skip;
+    }
+    return decode_game(r, &p, end, seq, cap, end_square);
+}
+
+/*
+ * trace_stats:
+ *   Decode the trace block by block, feeding each game with its global
+ *   index to stats_add_game. Memory use is one decoded game at a time.
+ */
+Stats *trace_stats(const TraceReader *r, const Board *b, RetainSpec keep) {
+    Stats *st = stats_create(b, keep);
+    if (!st) return NULL;
+
+    size_t *seq = NULL, cap = 0;
+    uint64_t game = 0;
+    for (size_t blk = 0; blk < r->n_blocks; ++blk) {
+        const uint8_t *p, *end;
+        if (!block_bounds(r, blk, &p, &end))
+            goto fail;
+        for (unsigned i = 0; i < r->block_games && game < r->n_games;
+             ++i, ++game) {
+            size_t square;
+            size_t rolls = decode_game(r, &p, end, &seq, &cap, &square);
+            if (rolls == (size_t)-1 ||
+                stats_add_game(st, b, (size_t)(r->first_game + game),
+                               seq, rolls, square) != 0)
+                goto fail;
+        }
+    }
+    free(seq);
+    return st;
+
+fail:
+    free(seq);
+    stats_free(st);
+    return NULL;
+}
+
+/*
+ * trace_close_reader:
+ *   Release the mapping and the reader struct.
+ */
+void trace_close_reader(TraceReader *r) {
+    if (!r) return;
+    munmap((void *)r->base, r->size);
+    free(r);
+}
@@ -0,0 +1,122 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#include "board.h"
+#include "stats.h"
+
+/*
+ * Trace file format (all integers little-endian):
+ *   header (64 bytes):
+ *     "PFTRACE\0", u32 version, u32 face_bits, u64 die_sides, u64 board_size,
+ *     u64 first_game, u64 n_games, u64 index_offset, u32 block_games, u32 0
+ *   blocks: up to block_games games each; per game a varint roll count
+ *           followed by the faces bit-packed (face_bits each, byte-aligned
+ *           per game). Aborted games have a roll count of 0 followed by a
+ *           varint of the square they ended on.
+ *   index:  at index_offset, one u64 file offset per block.
+ */
+#define TRACE_BLOCK_GAMES 4096
+
+/*
+ * TraceWriter:
+ *   Streams games to a trace file through a large in-memory buffer.
+ *   - f:          destination file.
+ *   - buf/len/cap: pending bytes not yet handed to fwrite.
+ *   - written:    bytes already written to f (file offset of buf[0]).
+ *   - offsets:    file offset of each started block (n_blocks entries).
+ *   - n_games:    games written so far.
+ */
+typedef struct {
+    FILE     *f;
+    uint8_t  *buf;
+    size_t    len, cap;
+    uint64_t  written;
+    uint64_t *offsets;
+    size_t    n_blocks, blocks_cap;
+    uint64_t  n_games;
+    uint64_t  first_game;
+    uint64_t  die_sides;
+    uint64_t  board_size;
+    unsigned  face_bits;
+} TraceWriter;
+
+/*
+ * trace_create:
+ *   Open `path` for writing a trace of games starting at global index
+ *   first_game. Returns NULL if the file cannot be created.
+ */
+TraceWriter *trace_create(const char *path, size_t die_sides,
+                          size_t board_size, size_t first_game);
+
+/*
+ * trace_write_game:
+ *   Append one game (rolls == 0 for an aborted game; `end` is only stored
+ *   for aborted games, a win always ends on the last square).
+ *   Returns 0 on success, -1 on allocation or write failure.
+ */
+int trace_write_game(TraceWriter *w, const size_t *seq, size_t rolls,
+                     size_t end);
+
+/*
+ * trace_close:
+ *   Flush pending data, write the block index, finalize the header and
+ *   close the file. Frees w. Returns 0 on success, -1 on any write error.
+ */
+int trace_close(TraceWriter *w);
+
+/*
+ * TraceReader:
+ *   Read-only view of a trace file mapped into memory.
+ *   - base/size: the mapping.
+ *   - index:     pointer to the block offset table inside the mapping.
+ */
+typedef struct {
+    const uint8_t *base;
+    size_t         size;
+    const uint8_t *index;
+    size_t         n_blocks;
+    uint64_t       n_games;
+    uint64_t       first_game;
+    uint64_t       die_sides;
+    uint64_t       board_size;
+    unsigned       face_bits;
+    unsigned       block_games;
+} TraceReader;
+
+/*
+ * trace_open:
+ *   Map a trace file and validate its header and index.
+ *   Returns NULL on I/O error or a malformed file.
+ */
+TraceReader *trace_open(const char *path);
+
+/*
+ * trace_game:
+ *   Decode game `game` (global index) into *seq, growing the buffer as
+ *   needed, and store the square it ended on in *end. Only the game's
+ *   block is touched.
+ *   Returns the roll count (0 for an aborted game) or (size_t)-1 if the
+ *   game is not in the trace or the data is corrupt.
+ */
+size_t trace_game(const TraceReader *r, size_t game,
+                  size_t **seq, size_t *cap, size_t *end);
+
+/*
+ * trace_stats:
+ *   Stream every game of the trace through stats_add_game, retaining the
+ *   example games described by `keep`.
+ *   Returns a new Stats, or NULL on corrupt data or allocation failure.
+ */
+Stats *trace_stats(const TraceReader *r, const Board *b, RetainSpec keep);
+
+/*
+ * trace_close_reader:
+ *   Unmap the trace and free r. Safe to call with a NULL pointer.
+ */
+void trace_close_reader(TraceReader *r);
+
+#endif /* TRACE_H */